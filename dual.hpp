@@ -0,0 +1,90 @@
+#pragma once
+#include <cmath>
+#include <ostream>
+
+// Forward mode dual number: a value and its derivatives with respect to N
+// seeded parameters, carried through arithmetic by the chain rule. Only the
+// value takes part in comparisons and printing.
+template <int N>
+struct Dual {
+	double v = 0.;
+	double d[N] = {};
+
+	Dual() {}
+	Dual(double v) : v(v) {}
+
+	explicit operator double() const { return v; }
+	explicit operator float() const { return float(v); }
+
+	Dual& operator+=(const Dual& b) {
+		v += b.v;
+		for (int i = 0; i < N; ++i) d[i] += b.d[i];
+		return *this;
+	}
+	Dual& operator-=(const Dual& b) {
+		v -= b.v;
+		for (int i = 0; i < N; ++i) d[i] -= b.d[i];
+		return *this;
+	}
+	Dual& operator*=(const Dual& b) {
+		for (int i = 0; i < N; ++i) d[i] = d[i] * b.v + v * b.d[i];
+		v *= b.v;
+		return *this;
+	}
+	Dual& operator/=(const Dual& b) {
+		v /= b.v;
+		for (int i = 0; i < N; ++i) d[i] = (d[i] - v * b.d[i]) / b.v;
+		return *this;
+	}
+
+	friend Dual operator-(Dual a) {
+		a.v = -a.v;
+		for (int i = 0; i < N; ++i) a.d[i] = -a.d[i];
+		return a;
+	}
+	friend Dual operator+(Dual a, const Dual& b) { return a += b; }
+	friend Dual operator-(Dual a, const Dual& b) { return a -= b; }
+	friend Dual operator*(Dual a, const Dual& b) { return a *= b; }
+	friend Dual operator/(Dual a, const Dual& b) { return a /= b; }
+
+	friend bool operator==(const Dual& a, const Dual& b) { return a.v == b.v; }
+	friend bool operator!=(const Dual& a, const Dual& b) { return a.v != b.v; }
+	friend bool operator<(const Dual& a, const Dual& b) { return a.v < b.v; }
+	friend bool operator>(const Dual& a, const Dual& b) { return a.v > b.v; }
+	friend bool operator<=(const Dual& a, const Dual& b) { return a.v <= b.v; }
+	friend bool operator>=(const Dual& a, const Dual& b) { return a.v >= b.v; }
+
+	friend std::ostream& operator<<(std::ostream& out, const Dual& a) { return out << a.v; }
+
+	// found by argument dependent lookup next to "using std::sqrt;" and co.
+	friend Dual chain(Dual a, double value, double derivative) {
+		a.v = value;
+		for (int i = 0; i < N; ++i) a.d[i] *= derivative;
+		return a;
+	}
+	friend Dual sqrt(const Dual& a) {
+		double root = std::sqrt(a.v);
+		return chain(a, root, root > 0 ? 0.5 / root : 0.);
+	}
+	friend Dual sin(const Dual& a) { return chain(a, std::sin(a.v), std::cos(a.v)); }
+	friend Dual cos(const Dual& a) { return chain(a, std::cos(a.v), -std::sin(a.v)); }
+	friend Dual abs(const Dual& a) { return a.v < 0 ? -a : a; }
+	friend bool isnan(const Dual& a) { return std::isnan(a.v); }
+	friend Dual atan2(const Dual& y, const Dual& x) {
+		double r2 = x.v * x.v + y.v * y.v;
+		Dual result(std::atan2(y.v, x.v));
+		for (int i = 0; i < N; ++i)
+			result.d[i] = (x.v * y.d[i] - y.v * x.d[i]) / r2;
+		return result;
+	}
+
+	// value of a with the derivatives of b
+	friend Dual with_derivatives(const Dual& a, Dual b) {
+		b.v = a.v;
+		return b;
+	}
+};
+
+// plain numbers carry no derivatives
+inline double with_derivatives(double a, double) { return a; }
+inline float with_derivatives(float a, float) { return a; }
@@ -0,0 +1,129 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+void write_metrics_csv(std::ostream& out, std::size_t rows,
+	const std::vector<MetricColumn>& columns) {
+	// enough digits to read back the same double
+	std::streamsize precision = out.precision(std::numeric_limits<double>::max_digits10);
+	for (std::size_t c = 0; c < columns.size(); ++c)
+		out << (c ? "," : "") << columns[c].name;
+	out << '\n';
+	for (std::size_t i = 0; i < rows; ++i) {
+		for (std::size_t c = 0; c < columns.size(); ++c)
+			out << (c ? "," : "") << columns[c].value(i);
+		out << '\n';
+	}
+	out.precision(precision);
+}
+
+template <class T>
+static void write_raw(std::ostream& out, T value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+void write_metrics_binary(std::ostream& out, std::size_t rows,
+	const std::vector<MetricColumn>& columns) {
+	out.write("PURSUITM", 8);
+	write_raw<std::uint32_t>(out, 1);
+	write_raw<std::uint32_t>(out, columns.size());
+	write_raw<std::uint64_t>(out, rows);
+	for (const MetricColumn& column : columns) {
+		write_raw<std::uint32_t>(out, column.name.size());
+		out.write(column.name.data(), column.name.size());
+	}
+	for (const MetricColumn& column : columns)
+		for (std::size_t i = 0; i < rows; ++i)
+			write_raw<double>(out, column.value(i));
+}
+
+void print_metric_aggregates(std::ostream& out, std::size_t rows,
+	const std::vector<MetricColumn>& columns) {
+	for (const MetricColumn& column : columns) {
+		StreamingQuantile median(0.5), p90(0.9), p99(0.99);
+		std::size_t count = 0;
+		double sum = 0., minimum = std::numeric_limits<double>::infinity();
+		for (std::size_t i = 0; i < rows; ++i) {
+			double x = column.value(i);
+			if (column.time && x < 0) continue;
+			++count;
+			sum += x;
+			minimum = std::min(minimum, x);
+			median.add(x);
+			p90.add(x);
+			p99.add(x);
+		}
+		out << column.name << ": count " << count;
+		if (count)
+			out << " mean " << sum / count << " min " << minimum
+				<< " median " << median.value() << " p90 " << p90.value()
+				<< " p99 " << p99.value();
+		out << '\n';
+	}
+}
+
+StreamingQuantile::StreamingQuantile(double p) : p(p) {
+	double fraction[5] = { 0., p / 2, p, (1 + p) / 2, 1. };
+	for (int i = 0; i < 5; ++i) {
+		height[i] = 0.;
+		position[i] = i + 1;
+		desired[i] = 1 + 4 * fraction[i];
+		increment[i] = fraction[i];
+	}
+}
+
+void StreamingQuantile::add(double x) {
+	if (count < 5) {
+		height[count++] = x;
+		if (count == 5) std::sort(height, height + 5);
+		return;
+	}
+	++count;
+
+	int k;
+	if (x < height[0]) {
+		height[0] = x;
+		k = 0;
+	}
+	else if (x >= height[4]) {
+		height[4] = x;
+		k = 3;
+	}
+	else {
+		k = 0;
+		while (x >= height[k + 1]) ++k;
+	}
+	for (int i = k + 1; i < 5; ++i) position[i] += 1;
+	for (int i = 0; i < 5; ++i) desired[i] += increment[i];
+
+	// move the middle markers towards their desired positions
+	for (int i = 1; i <= 3; ++i) {
+		double d = desired[i] - position[i];
+		if ((d >= 1 && position[i + 1] - position[i] > 1) ||
+			(d <= -1 && position[i - 1] - position[i] < -1)) {
+			int s = d > 0 ? 1 : -1;
+			double parabolic = height[i] + s / (position[i + 1] - position[i - 1]) * (
+				(position[i] - position[i - 1] + s) * (height[i + 1] - height[i]) / (position[i + 1] - position[i]) +
+				(position[i + 1] - position[i] - s) * (height[i] - height[i - 1]) / (position[i] - position[i - 1]));
+			if (height[i - 1] < parabolic && parabolic < height[i + 1])
+				height[i] = parabolic;
+			else
+				height[i] += s * (height[i + s] - height[i]) / (position[i + s] - position[i]);
+			position[i] += s;
+		}
+	}
+}
+
+double StreamingQuantile::value() const {
+	if (count == 0) return std::nan("");
+	if (count < 5) {
+		// exact for the first few samples
+		double sorted[5];
+		std::copy(height, height + count, sorted);
+		std::sort(sorted, sorted + count);
+		return sorted[std::min(count - 1, std::size_t(std::floor(p * count)))];
+	}
+	return height[2];
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "simulation.hpp"
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Per-predator engagement metrics as named columns, read straight from the
+// simulation so nothing is copied for large swarms.
+struct MetricColumn {
+	std::string name;
+	std::function<double(std::size_t)> value;
+	bool time = false; // negative values mean "never" and are left out of aggregates
+};
+
+template <class Real>
+std::vector<MetricColumn> metric_columns(const BasicSimulation<Real>& S) {
+	auto& p = S.predators;
+	std::vector<MetricColumn> columns{
+		{ "lambda", [&p](std::size_t i) { return double(p[i].lambda); } },
+		{ "when_reached", [&p](std::size_t i) { return double(p[i].when_reached); }, true },
+		{ "path_length", [&p](std::size_t i) { return double(p[i].path_length); } },
+		{ "min_range", [&p](std::size_t i) { return double(p[i].min_range); } },
+		{ "peak_turn_rate", [&p](std::size_t i) { return double(p[i].peak_turn_rate); } },
+		{ "miss_distance", [&S](std::size_t i) { return double(S.missDistance(S.predators[i])); } },
+	};
+	for (std::size_t r = 0; r < S.metric_radii.size(); ++r) {
+		std::ostringstream name;
+		name << "time_within_" << S.metric_radii[r];
+		columns.push_back({ name.str(),
+			[&p, r](std::size_t i) { return double(p[i].time_within[r]); }, true });
+	}
+	return columns;
+}
+
+// one line per predator with a header line
+void write_metrics_csv(std::ostream& out, std::size_t rows,
+	const std::vector<MetricColumn>& columns);
+
+// "PURSUITM", uint32 version, uint32 column count, uint64 row count, every
+// column name as uint32 length and bytes, then each column as rows float64
+// values in host byte order
+void write_metrics_binary(std::ostream& out, std::size_t rows,
+	const std::vector<MetricColumn>& columns);
+
+// count, mean, min, median, 90th and 99th percentile of every column, with
+// quantiles estimated in constant memory (P-square algorithm)
+void print_metric_aggregates(std::ostream& out, std::size_t rows,
+	const std::vector<MetricColumn>& columns);
+
+// P-square estimate of one quantile from a stream (Jain and Chlamtac, 1985)
+class StreamingQuantile {
+	double p;
+	double height[5];
+	double position[5];
+	double desired[5];
+	double increment[5];
+	std::size_t count = 0;
+
+public:
+	explicit StreamingQuantile(double p);
+	void add(double x);
+	double value() const;
+};
@@ -0,0 +1,15 @@
+#include "profile.hpp"
+// Counts every allocation of the profiling build. Kept in its own file so
+// the replaced operators are never inlined next to standard library code.
+#ifdef PURSUIT_PROFILE
+#include <cstdlib>
+#include <new>
+
+void* operator new(std::size_t size) {
+	S_prof::allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
@@ -0,0 +1,141 @@
+#pragma once
+
+// Build with -DPURSUIT_PROFILE (make profile) to get per-phase timings and
+// counters. Without it the PROFILE_ macros expand to nothing.
+#ifdef PURSUIT_PROFILE
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+namespace S_prof {
+	enum Phase {
+		capture, plan, guidance, prey, trail, simulate, parse, render, encode, phase_count
+	};
+	inline const char* const phase_names[phase_count] = {
+		"capture", "plan", "guidance", "prey", "trail", "simulate", "parse", "render", "encode"
+	}; // simulate is the total of the phases before it plus loop overhead
+
+	// step phases are timed on one step in sample_period
+	constexpr unsigned sample_period = 64;
+
+	inline std::atomic<unsigned long long> phase_ns[phase_count];
+	inline std::atomic<unsigned long long> steps{ 0 };
+	inline std::atomic<unsigned long long> sampled_steps{ 0 };
+	inline std::atomic<unsigned long long> active_predators{ 0 }; // summed over steps
+	inline std::atomic<unsigned long long> trail_vertices{ 0 };
+	inline std::atomic<unsigned long long> allocations{ 0 };
+
+	class ScopedTimer {
+		Phase phase;
+		std::chrono::steady_clock::time_point start;
+	public:
+		explicit ScopedTimer(Phase phase)
+			: phase(phase), start(std::chrono::steady_clock::now()) {}
+		~ScopedTimer() {
+			phase_ns[phase].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+		}
+	};
+
+	// Step loop counters of one simulation: plain integers, merged into the
+	// totals above by flush() and when the simulation goes away. A copy
+	// starts from zero so nothing is merged twice.
+	struct StepCounters {
+		unsigned long long phase_ns[phase_count] = {};
+		unsigned long long steps = 0;
+		unsigned long long sampled_steps = 0;
+		unsigned long long active_predators = 0;
+		unsigned long long trail_vertices = 0;
+		unsigned long long timers = 0; // started in sampled steps, see StepTimer
+		bool sampling = false;
+
+		StepCounters() {}
+		StepCounters(const StepCounters&) {}
+		StepCounters& operator=(const StepCounters&) { return *this; }
+		~StepCounters() { flush(); }
+
+		void begin_step() {
+			sampling = steps++ % sample_period == 0;
+			sampled_steps += sampling;
+		}
+
+		void flush() {
+			for (int i = 0; i < phase_count; ++i)
+				S_prof::phase_ns[i].fetch_add(phase_ns[i], std::memory_order_relaxed);
+			S_prof::steps.fetch_add(steps, std::memory_order_relaxed);
+			S_prof::sampled_steps.fetch_add(sampled_steps, std::memory_order_relaxed);
+			S_prof::active_predators.fetch_add(active_predators, std::memory_order_relaxed);
+			S_prof::trail_vertices.fetch_add(trail_vertices, std::memory_order_relaxed);
+			for (auto& ns : phase_ns) ns = 0;
+			steps = sampled_steps = active_predators = trail_vertices = timers = 0;
+		}
+	};
+
+	// average cost of reading the clock, measured once
+	inline long long clock_ns() {
+		static const long long ns = [] {
+			const int n = 1000;
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < n; ++i) std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count() / n;
+		}();
+		return ns;
+	}
+
+	// Times a phase of a sampled step, without the clock reads it and any
+	// timers nested in it add
+	class StepTimer {
+		StepCounters& counters;
+		Phase phase;
+		unsigned long long nested;
+		std::chrono::steady_clock::time_point start;
+	public:
+		StepTimer(StepCounters& counters, Phase phase) : counters(counters), phase(phase) {
+			if (!counters.sampling) return;
+			nested = ++counters.timers;
+			start = std::chrono::steady_clock::now();
+		}
+		~StepTimer() {
+			if (!counters.sampling) return;
+			long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			ns -= clock_ns() * (1 + 2 * (counters.timers - nested));
+			counters.phase_ns[phase] += ns > 0 ? ns : 0;
+		}
+	};
+
+	inline void summary(std::ostream& out) {
+		unsigned long long n = steps, sampled = sampled_steps;
+		out << "Steps: " << n << " (" << sampled << " timed)"
+			<< "\nActive predators per step: " << (n ? double(active_predators) / n : 0.)
+			<< "\nTrail vertices: " << trail_vertices
+			<< "\nAllocations: " << allocations;
+		for (int i = 0; i < phase_count; ++i) {
+			if (i < parse)
+				out << "\n" << phase_names[i] << ": "
+					<< (sampled ? double(phase_ns[i]) / sampled : 0.) << " ns/step";
+			else
+				out << "\n" << phase_names[i] << ": " << phase_ns[i] / 1000000. << " ms";
+		}
+	}
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) \
+	S_prof::ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__)(S_prof::phase)
+#define PROFILE_COUNT(counter, n) \
+	S_prof::counter.fetch_add((n), std::memory_order_relaxed)
+// inside the step loop, with the simulation's own profile_counters
+#define PROFILE_STEP() profile_counters.begin_step()
+#define PROFILE_STEP_SCOPE(phase) \
+	S_prof::StepTimer PROFILE_CONCAT(profile_scope_, __LINE__)(profile_counters, S_prof::phase)
+#define PROFILE_STEP_COUNT(counter, n) (profile_counters.counter += (n))
+#else
+#define PROFILE_SCOPE(phase)
+#define PROFILE_COUNT(counter, n)
+#define PROFILE_STEP()
+#define PROFILE_STEP_SCOPE(phase)
+#define PROFILE_STEP_COUNT(counter, n)
+#endif
@@ -1,654 +1,1113 @@
-#include <SFML/Graphics.hpp>
-#include <iostream>
+#include "simulation.hpp"
+#include "profile.hpp"
+#include "metrics.hpp"
 #include <fstream>
-#include <regex>
-#include <map>
-#include <list>
-#include <cmath>
 #include <sstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cctype>
+#include <functional>
+#include <memory>
+#include <filesystem>
+#include <iterator>
+#include <cstdint>
+#include <limits>
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <csignal>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+const unsigned int DEF_WIN_X = 1280, DEF_WIN_Y = 720; // default window size
 
-const double PI = 3.1415926535897932;
-typedef sf::Vector2<double> vec2;
-
-namespace S_re {
-	const std::regex property("\\s*([_a-zA-Z0-9]+)\\s*=\\s*(.+?)(?:;.*)?");
-	const std::regex empty_line("\\s*(?:;.*)?");
-	const std::regex preycontrol("\\s*PreyControl:\\s*?(?:;.*)?");
-	const std::regex predator("\\s*Predator:\\s*?(?:;.*)?");
-	const std::regex control_value(
-		"\\s*(-?\\d+(?:\\.\\d*)?)"
-		"\\s*(-?\\d+(?:\\.\\d*)?)"
-		"\\s*(\\d+(?:\\.\\d*)?)?"
-		"\\s*(?:;.*)?"
-	); // u.x, u.y, duration
-	const std::regex rotate_value(
-		"\\s*rotate"
-		"\\s*(-?\\d+(?:\\.\\d*)?d?)"
-		"\\s*(\\d+(?:\\.\\d*)?d?)?"
-		"\\s*(-?\\d+(?:\\.\\d*)?d?)?" // d?
-		"\\s*(?:;.*)?"
-	); // rotate, rotation speed, duration, starting rotation
-
-	const std::regex numbers{
-		"(-?\\d+(?:\\.\\d*)?)\\s*"
-		"(?:,\\s*(-?\\d+(?:\\.\\d*)?)\\s*)?"
-		"(?:,\\s*(-?\\d+(?:\\.\\d*)?)\\s*)?"
-	};
-}
-
-class Simulation : public sf::Drawable {
-
-public:
-	struct Predator : sf::CircleShape {
-		double lambda = 0;
-		vec2 position;
-		vec2 velocity;
-		sf::Color color {0, 0, 0, 0}; 
-		//zero opacity for further default initialization
-		sf::VertexArray trail{ sf::PrimitiveType::Lines };
-		float when_reached = -1.f;
-	};
-	
-	std::list<Predator> predators;
-
-private:
-	struct Movement {
-		bool rotating;
-		double x; // rotation speed
-		double y; // rotation starting direction
-		double duration;
-		Movement(bool rotating, double x, double y, double duration)
-			: rotating(rotating), x(x), y(y), duration(duration) {}
-	};
-
-	std::list<Movement> movements;
-	std::list<Movement>::iterator current_movement;
-	double time_of_next_movement = 0.;
-
-	sf::CircleShape prey;
-
-	vec2 prey_position{ 0., 0. };
-	vec2 prey_velocity{ 0., 0. };
-
-	bool trail_on_gap = true;
-	bool move_by_plan = true;
-
-	float elapsed_last = 0.f;
+double len(vec2 v) { return std::sqrt(v.x * v.x + v.y * v.y); }
 
-	bool valid = false;
+vec2 new_velocity(float elapsed) {
+	const float speed = 1.f;
+	static float phase = 0.f;
+	phase += elapsed * speed;
+	return { 4. * std::cos(phase), 4. * std::sin(phase) };
+}
 
-	static sf::Vector2f to_vec2f(vec2 v) {
-		return sf::Vector2f{ (float)v.x, (float)v.y };
+template <class Real>
+void print_results(std::ostream& out, const BasicSimulation<Real>& S, bool compact) {
+	for (const auto& predator : S.predators) {
+		if (compact) {
+			out << predator.lambda << ' ' << predator.when_reached << '\n';
+		}
+		else {
+			out << "Lambda " << predator.lambda 
+				<< " reached at " << predator.when_reached << '\n';
+		}
 	}
+}
 
-	static double dot_product(vec2 z, vec2 v) {
-		return z.x * v.x + z.y * v.y;
+// capture times followed by their derivatives, see seed_sensitivities()
+void print_sensitivities(std::ostream& out, const SimulationD& S, bool compact) {
+	for (const SimulationD::Predator& predator : S.predators) {
+		const double* d = predator.when_reached.d;
+		if (compact) {
+			out << predator.lambda << ' ' << predator.when_reached;
+			for (int i = 0; i < sensitivity_count; ++i)
+				out << ' ' << d[i];
+			out << '\n';
+		}
+		else {
+			out << "Lambda " << predator.lambda
+				<< " reached at " << predator.when_reached
+				<< ", d/dLambda " << d[d_lambda]
+				<< ", d/dPosition (" << d[d_position_x] << ", " << d[d_position_y]
+				<< "), d/dPreySpeed " << d[d_prey_speed]
+				<< ", d/dPredatorsSpeed " << d[d_predators_speed] << '\n';
+		}
 	}
+}
 
-	static double distance(vec2 a, vec2 b) {
-		vec2 r = a - b;
-		return std::sqrt(dot_product(r, r));
+// Writes engagement metrics to path (columnar binary for *.bin, CSV otherwise)
+// through a large buffer, and their aggregates to stderr if asked for
+template <class Real>
+bool report_metrics(const BasicSimulation<Real>& S, const std::string& path, bool aggregates) {
+	std::vector<MetricColumn> columns = metric_columns(S);
+	if (!path.empty()) {
+		std::vector<char> buffer(1 << 20);
+		std::ofstream out;
+		out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+		out.open(path, std::ios::binary);
+		if (!out.is_open()) {
+			std::cout << "Can't open file " << path << "\n";
+			return false;
+		}
+		if (std::filesystem::path(path).extension() == ".bin")
+			write_metrics_binary(out, S.predators.size(), columns);
+		else
+			write_metrics_csv(out, S.predators.size(), columns);
+		out.close();
 	}
+	if (aggregates)
+		print_metric_aggregates(std::cerr, S.predators.size(), columns);
+	return true;
+}
 
-	static vec2 normalize(vec2 v, double target_length) {
-		if (v == vec2()) return v;
-		double len = std::sqrt(dot_product(v, v));
-		return vec2(v.x * target_length / len,
-			v.y * target_length / len);
+// Fixed set of worker threads running queued tasks. With max_queued set,
+// push() blocks while the queue is full so producers can't run ahead.
+class TaskPool {
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> queue;
+	std::mutex mutex;
+	std::condition_variable can_pop, can_push, done;
+	std::size_t max_queued;
+	std::size_t unfinished = 0;
+	bool closing = false;
+
+	void work() {
+		while (true) {
+			std::unique_lock<std::mutex> lock(mutex);
+			can_pop.wait(lock, [this] { return closing || !queue.empty(); });
+			if (queue.empty()) return;
+			std::function<void()> task = std::move(queue.front());
+			queue.pop_front();
+			lock.unlock();
+			can_push.notify_one();
+			task();
+			lock.lock();
+			if (--unfinished == 0) done.notify_all();
+		}
 	}
 
-	static void align_rotation_to_vec(sf::Transformable& obj, sf::Vector2f vec) {
-		if (vec != sf::Vector2f())
-			obj.setRotation(std::atan2(vec.x, -vec.y) * 180.f / (float)PI);
+public:
+	TaskPool(unsigned threads, std::size_t max_queued = 0) : max_queued(max_queued) {
+		for (unsigned i = 0; i < threads; ++i)
+			workers.emplace_back(&TaskPool::work, this);
 	}
 
-	static double alpha(vec2 z, vec2 v, double a) {
-		double zz = dot_product(z, z);
-		double vv = dot_product(v, v);
-		double zv = dot_product(z, v);
-		double root = std::sqrt(zv * zv + zz * (a * a - vv));
-		return (zv + root) / zz;
-	}
+	~TaskPool() { finish(); }
 
-	bool predator_close_to_prey(const Predator& predator) {
-		return distance(prey_position, predator.position) <
-			(predators_speed - prey_speed) * elapsed_last;
+	static unsigned default_threads() {
+		unsigned cores = std::thread::hardware_concurrency();
+		return cores ? cores : 1;
 	}
 
-	//for file initialization begin
-
-	static bool match_number_count(
-		const std::string& str, std::smatch& number_match, int count
-	) {
-		bool can_be_neg = count < 0;
-		if (can_be_neg) count = -count;
-		if (!std::regex_match(str, number_match, S_re::numbers))
-			return false;
-		if (number_match[count + 1].length() || !number_match[count].length())
-			return false;
-		if (!can_be_neg)
-			for (int i = 1; i <= count; ++i)
-				if (*number_match[i].str().begin() == '-')
-					return false;
-		return true;
+	void push(std::function<void()> task) {
+		std::unique_lock<std::mutex> lock(mutex);
+		can_push.wait(lock, [this] { return !max_queued || queue.size() < max_queued; });
+		queue.push_back(std::move(task));
+		++unfinished;
+		lock.unlock();
+		can_pop.notify_one();
 	}
 
-	bool set_prey_position(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, -2))
-			return false;
-		prey_position = vec2(std::stod(i_match[1]), std::stod(i_match[2]));
-		return true;
+	// blocks until every task pushed so far has finished
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return unfinished == 0; });
 	}
 
-	bool set_predator_position(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, -2))
-			return false;
-		predators.back().position = vec2(std::stod(i_match[1]), std::stod(i_match[2]));
-		return true;
+	// runs the remaining tasks and joins the workers
+	void finish() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		can_pop.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
 	}
+};
 
-	bool set_prey_speed(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		prey_speed = std::stod(i_match[1]);
-		return true;
-	}
+// largest difference of capture times between two runs of one scenario
+template <class A, class B>
+double capture_difference(const A& a, const B& b) {
+	double difference = 0.;
+	for (std::size_t i = 0; i < a.predators.size(); ++i)
+		difference = std::max(difference, std::abs(
+			double(a.predators[i].when_reached) - double(b.predators[i].when_reached)));
+	return difference;
+}
 
-	bool set_predators_speed(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		predators_speed = std::stod(i_match[1]);
-		return true;
-	}
+struct PararealReport {
+	unsigned slices = 0;
+	unsigned windows = 0;
+	unsigned iterations = 0; // over all windows
+	unsigned serial_windows = 0; // took as many iterations as slices, no speedup
+	double defect = 0.; // largest state change in the last iteration
+	double horizon = 0.;
+};
 
-	bool set_prey_color(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 3))
-			return false;
-		prey_color = sf::Color(
-			std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
-		return true;
+// Parareal time-parallel integration of one window of slices * slice_steps
+// steps from S. A coarse propagator G (steps coarse_ratio times larger) sweeps
+// the window serially, the fine propagator F (the same steps as a serial
+// headless run) runs on all time slices in parallel, and slice starts are
+// corrected as U[n+1] = G(new U[n]) + F(old U[n]) - G(old U[n]) until two
+// iterations agree on positions and captures. Captures and the prey plan come
+// from F, so a converged window matches the serial run. Returns iterations.
+unsigned parareal_window(Simulation& S, double step, unsigned slices,
+	unsigned long long slice_steps, unsigned coarse_ratio, double tolerance,
+	TaskPool& pool, PararealReport& report) {
+	unsigned long long coarse_steps = std::max(1ull, slice_steps / coarse_ratio);
+	double coarse_step = double(slice_steps) * step / coarse_steps;
+
+	// slice start times exactly as the serial run accumulates them
+	std::vector<double> timers{ S.simulation_timer };
+	for (unsigned n = 0; n < slices; ++n) {
+		double timer = timers.back();
+		for (unsigned long long i = 0; i < slice_steps; ++i) timer += step;
+		timers.push_back(timer);
 	}
 
-	bool set_predator_color(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 3))
-			return false;
-		predators.back().color = sf::Color(
-			std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
-		return true;
-	}
+	auto fine = [&](const Simulation& start, unsigned n) {
+		Simulation result = start;
+		for (unsigned long long i = 0; i < slice_steps && !result.all_reached(); ++i)
+			result.singleStepSimulate(step);
+		result.simulation_timer = timers[n + 1];
+		return result;
+	};
+	auto coarse = [&](const Simulation& start, unsigned n) {
+		Simulation result = start;
+		for (unsigned long long i = 0; i < coarse_steps; ++i)
+			result.singleStepSimulate(coarse_step);
+		result.simulation_timer = timers[n + 1];
+		return result;
+	};
 
-	bool set_lambda(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		predators.back().lambda = std::stod(i_match[1]);
-		return predators.back().lambda >= 0 && 
-			predators.back().lambda <= 1;
+	std::vector<Simulation> U(slices + 1), G(slices + 1), F(slices + 1);
+	U[0] = S;
+	for (unsigned n = 0; n < slices; ++n)
+		U[n + 1] = G[n + 1] = coarse(U[n], n);
+
+	unsigned iterations = 0;
+	for (unsigned k = 0; k < slices; ++k) {
+		for (unsigned n = k; n < slices; ++n)
+			pool.push([&, n] { F[n + 1] = fine(U[n], n); });
+		pool.wait();
+
+		double defect = 0., scale = 1.;
+		bool captures_changed = false;
+		for (unsigned n = k; n < slices; ++n) {
+			Simulation coarse_new = coarse(U[n], n);
+			std::vector<double> state = F[n + 1].getState();
+			std::vector<double> coarse_now = coarse_new.getState();
+			std::vector<double> coarse_old = G[n + 1].getState();
+			std::vector<double> previous = U[n + 1].getState();
+			for (std::size_t i = 0; i < state.size(); ++i) {
+				// exactly the fine state once the coarse one stops changing
+				state[i] += coarse_now[i] - coarse_old[i];
+				defect = std::max(defect, std::abs(state[i] - previous[i]));
+				scale = std::max(scale, std::abs(state[i]));
+			}
+			Simulation corrected = F[n + 1];
+			for (std::size_t i = 0; i < S.predators.size(); ++i) {
+				// F[n + 1] may have started before this capture was known, but a
+				// caught predator stays where and when it was caught
+				const Simulation::Predator& caught = U[n].predators[i];
+				if (caught.when_reached >= 0.f) {
+					corrected.setReached(i, caught.when_reached);
+					state[4 + 2 * i] = caught.position.x;
+					state[5 + 2 * i] = caught.position.y;
+				}
+				if (corrected.predators[i].when_reached != U[n + 1].predators[i].when_reached)
+					captures_changed = true;
+			}
+			corrected.setState(state);
+			U[n + 1] = std::move(corrected);
+			G[n + 1] = std::move(coarse_new);
+		}
+		iterations = k + 1;
+		report.defect = defect;
+		// captures only move one slice per iteration, so they must settle too
+		if (!captures_changed && defect <= tolerance * scale) break;
 	}
+	S = U[slices];
+	return iterations;
+}
 
-	bool set_background_color(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 3))
-			return false;
-		background_color = sf::Color(
-			std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
-		return true;
+// Parareal over windows that start at ten coarse steps per slice and double
+// until every predator is caught. A horizon guessed from a coarse run can be
+// far off or never come, since large steps may orbit the prey instead of
+// catching it; growing windows keep the engagement spread over the slices and
+// end exactly when the serial run does.
+PararealReport simulate_parareal(Simulation& S, double step, unsigned slices,
+	unsigned coarse_ratio = 100, double tolerance = 1e-9) {
+	PararealReport report;
+	report.slices = slices;
+
+	bool record_trails = S.record_trails;
+	int substeps = S.substeps;
+	S.record_trails = false;
+	S.substeps = 1;
+
+	TaskPool pool(std::min(slices, TaskPool::default_threads()));
+	for (unsigned long long slice_steps = 10ull * coarse_ratio; !S.all_reached(); slice_steps *= 2) {
+		unsigned iterations = parareal_window(S, step, slices, slice_steps,
+			coarse_ratio, tolerance, pool, report);
+		++report.windows;
+		report.iterations += iterations;
+		if (iterations == slices) ++report.serial_windows;
 	}
+	pool.finish();
+	report.horizon = S.simulation_timer;
 
-	bool set_text_color(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 3))
-			return false;
-		text_color = sf::Color(
-			std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
-		return true;
-	}
+	S.record_trails = record_trails;
+	S.substeps = substeps;
+	return report;
+}
 
-	bool set_character_size(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		character_size = std::stoi(i_match[1]);
-		return true;
+// Renders the simulation off-screen at a fixed simulated frame rate until all
+// predators reach the prey or duration runs out, writing <prefix>000000.png,
+// <prefix>000001.png, ...
+int export_frames(Simulation& S, unsigned width, unsigned height, float fps,
+	const std::string& prefix, double max_step, double duration) {
+	sf::ContextSettings context_settings;
+	context_settings.antialiasingLevel = 8;
+	sf::RenderTexture texture;
+	if (!texture.create(width, height, context_settings)) {
+		std::cout << "Can't create " << width << 'x' << height << " render texture\n";
+		return -1;
 	}
 
-	bool set_point_radius(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		base_radius = std::stod(i_match[1]);
-		return true;
-	}
+	// same world area as the default window, just more pixels
+	float world_width = DEF_WIN_X * S.zoom;
+	texture.setView(sf::View(sf::Vector2f(),
+		sf::Vector2f(world_width, world_width * height / width)));
+
+	double frame_time = 1. / fps;
+	S.substeps = std::max(1, (int)std::ceil(frame_time / max_step));
+	S.applyZoom();
+
+	// PNG encoding and disk writes overlap with simulating and rendering the
+	// next frames; the bounded queue keeps memory in check for large frames
+	unsigned threads = std::max(1u, TaskPool::default_threads() - 1);
+	TaskPool writers(threads, 2 * threads);
+	std::atomic<bool> failed{ false };
+	char number[16];
+	double end_time = S.simulation_timer + duration;
+	for (unsigned frame = 0; ; ++frame) {
+		{
+			PROFILE_SCOPE(render);
+			texture.clear(S.background_color);
+			texture.draw(S);
+			texture.display();
+		}
+		std::snprintf(number, sizeof number, "%06u", frame);
+		std::string path = prefix + number + ".png";
+		sf::Image image = texture.getTexture().copyToImage();
+		writers.push([path, image = std::move(image), &failed] {
+			PROFILE_SCOPE(encode);
+			if (!image.saveToFile(path)) {
+				std::cout << "Can't write frame " << path << "\n";
+				failed = true;
+			}
+		});
 
-	bool set_trail(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 2))
-			return false;
-		trail_dash_time = std::stod(i_match[1]);
-		trail_gap_time = std::stod(i_match[2]);
-		return true;
+		if (S.all_reached()) break;
+		if (S.simulation_timer + frame_time > end_time) {
+			std::cout << "Export stopped at the " << duration
+				<< " s limit after " << frame + 1 << " frames\n";
+			break;
+		}
+		S.simulate(frame_time);
 	}
+	writers.finish();
+	return failed ? -1 : 0;
+}
 
-	bool set_zoom(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		zoom = std::stod(i_match[1]);
-		return true;
+// Server mode: a request is a header line "<id> <length> [step [budget]]"
+// followed by <length> bytes of scenario text. Requests run concurrently and
+// each is answered as soon as it completes with "<id> ok <n>" or
+// "<id> error <n>" followed by n lines of results or messages.
+struct Connection {
+	std::istream& in;
+	std::ostream& out;
+	std::mutex out_mutex;
+	Connection(std::istream& in, std::ostream& out) : in(in), out(out) {}
+	virtual ~Connection() {}
+
+	static std::string response(const std::string& id, bool ok, const std::string& lines) {
+		std::size_t count = std::count(lines.begin(), lines.end(), '\n');
+		return id + (ok ? " ok " : " error ") + std::to_string(count) + '\n' + lines;
 	}
 
-	bool set_scale_speed(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		scale_speed = std::stod(i_match[1]);
-		return true;
+	void respond(const std::string& id, bool ok, const std::string& lines) {
+		std::lock_guard<std::mutex> lock(out_mutex);
+		out << response(id, ok, lines);
+		out.flush();
 	}
+};
 
-	bool set_rotation_acceleration(std::smatch& match) {
-		std::smatch i_match;
-		const std::string& str = match[2].str();
-		if (!match_number_count(str, i_match, 1))
-			return false;
-		prey_rotation_acceleration = std::stod(i_match[1]);
-		return true;
-	}
+// runs one scenario, writing compact results or parser messages to lines
+bool run_scenario(std::istream& file, std::ostream& lines, double step, double budget) {
+	Simulation S(file, lines);
+	if (!S.is_valid()) return false;
+	S.record_trails = false;
+	S.simulateUntilReached(step, budget);
+	print_results(lines, S, true);
+	return true;
+}
 
-	bool add_straight_control(std::smatch& match) {
-		if (!movements.empty() && movements.back().duration == 0.) {
-			movements.pop_back();
-		}
-		double dur = match[3].length() ? std::stod(match[3]) : 0.;
-		movements.emplace_back(false,
-			std::stod(match[1]), std::stod(match[2]), dur);
-		return true;
+void run_request(Connection& connection, const std::string& id,
+	const std::string& config, double step, double budget) {
+	std::istringstream file(config);
+	std::ostringstream lines;
+	bool ok;
+	try {
+		ok = run_scenario(file, lines, step, budget);
+	}
+	catch (std::exception& e) {
+		// e.g. a number out of range in the scenario or running out of memory
+		lines.str("");
+		lines << "Can't run scenario: " << e.what() << '\n';
+		ok = false;
 	}
+	connection.respond(id, ok, lines.str());
+}
 
-	bool add_rotating_control(std::smatch& match) {
-		if (!movements.empty() && movements.back().duration == 0.) {
-			movements.pop_back();
+const long long max_request_length = 16 << 20;
+const double max_request_steps = 1e8;
+
+// requests without a time limit, or with a longer one, stop at max_time
+// simulated seconds so a scenario that never ends can't hold a worker; a
+// step too small for the limit is refused for the same reason
+void serve_connection(std::shared_ptr<Connection> connection, TaskPool& pool, double max_time) {
+	std::string header;
+	while (std::getline(connection->in, header)) {
+		if (!header.empty() && header.back() == '\r') header.pop_back();
+		if (header.empty()) continue;
+
+		std::istringstream fields(header);
+		std::string id;
+		long long length;
+		double step = 1e-3, budget = 0., value;
+		if (!(fields >> id >> length) || length < 0 || length > max_request_length) {
+			connection->respond(id.empty() ? "?" : id, false, "Bad request header\n");
+			return; // can't find the next request after a broken header
 		}
-		if (!match[2].str().empty() && *match[2].str().rbegin() == 'd')
-			return false;
+		if (fields >> value) {
+			step = value;
+			if (fields >> value) budget = value;
+		}
+		if (!(budget > 0.) || budget > max_time) budget = max_time;
 
-		double speed = std::stod(match[1]);
-		if (*match[1].str().rbegin() == 'd')
-			speed = speed * PI / 180.;
-		double dur = match[2].length() ? std::stod(match[2]) : 0.;
-		double start = match[3].length() ? std::stod(match[3]) : std::nan("");
-		if (match[3].length() != 0 && *match[3].str().rbegin() == 'd')
-			start = start * PI / 180.;
-		if (movements.empty() && !std::isnan(start))
-			align_rotation_to_vec(prey,
-				sf::Vector2f(std::cos(start), std::sin(start)));
-
-		movements.emplace_back(true,
-			speed, start, dur);
-		return true;
+		std::string config;
+		try {
+			config.resize(length);
+		}
+		catch (std::exception& e) {
+			connection->respond(id, false, "Request too large\n");
+			return;
+		}
+		if (!connection->in.read(&config[0], length)) {
+			connection->respond(id, false, "Unexpected end of request\n");
+			return;
+		}
+		if (!(step > 0.)) {
+			connection->respond(id, false, "Simulation step must be positive\n");
+			continue;
+		}
+		if (budget / step > max_request_steps) {
+			std::ostringstream message;
+			message << "Time limit " << budget << " needs more than "
+				<< max_request_steps << " steps of " << step << "\n";
+			connection->respond(id, false, message.str());
+			continue;
+		}
+		pool.push([connection, id, config, step, budget] {
+			run_request(*connection, id, config, step, budget);
+		});
 	}
+}
 
-	vec2 naiveDirection(const Predator& predator) {
-		return normalize(prey_position - predator.position, 1);
+#ifndef _WIN32
+class FdStreamBuf : public std::streambuf {
+	int fd;
+	char in_buffer[4096];
+	char out_buffer[4096];
+
+protected:
+	int_type underflow() override {
+		ssize_t n;
+		do n = ::read(fd, in_buffer, sizeof in_buffer);
+		while (n < 0 && errno == EINTR);
+		if (n <= 0) return traits_type::eof();
+		setg(in_buffer, in_buffer, in_buffer + n);
+		return traits_type::to_int_type(*gptr());
 	}
 
-	vec2 parallelDirection(const Predator& predator) {
-		double a = predators_speed / prey_speed;
-		vec2 z = (predator.position - prey_position) / prey_speed; // X -- parallel, Y -- prey
-		vec2 v = normalize(prey_velocity, prey_speed);
-		vec2 u = v - z * alpha(z, v, a);
-		return normalize(u, 1);
+	int_type overflow(int_type c) override {
+		if (sync() != 0) return traits_type::eof();
+		if (!traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
 	}
 
+	int sync() override {
+		for (char* p = pbase(); p < pptr();) {
+			ssize_t n = ::send(fd, p, pptr() - p, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return -1;
+			p += n;
+		}
+		setp(out_buffer, out_buffer + sizeof out_buffer);
+		return 0;
+	}
 
 public:
+	explicit FdStreamBuf(int fd) : fd(fd) {
+		setp(out_buffer, out_buffer + sizeof out_buffer);
+	}
+};
 
-	float base_radius = 15.f;
-	float zoom = 0.02f;
-	float scale_speed = 0.003f;
-	float prey_rotation_acceleration = 1.f;
-	float time_scale = 1.f;
-	int substeps = 1;
-	double prey_rotation_speed = 1.;
-	sf::Vector2f view_center{};
-
-	sf::View view;
+struct SocketStreams {
+	int fd;
+	FdStreamBuf in_buffer, out_buffer;
+	std::istream in_stream;
+	std::ostream out_stream;
+	SocketStreams(int fd) : fd(fd), in_buffer(fd), out_buffer(fd),
+		in_stream(&in_buffer), out_stream(&out_buffer) {}
+};
 
-	double prey_speed = 1.0; // 1.0
-	double predators_speed = 1.2; // 1.5
+struct SocketConnection : SocketStreams, Connection {
+	SocketConnection(int fd) : SocketStreams(fd), Connection(in_stream, out_stream) {}
+	~SocketConnection() { ::close(fd); }
+};
 
-	sf::Color prey_color{ sf::Color::Blue };
-	sf::Color background_color{ 247, 247, 247 };
-	sf::Color text_color{ 16, 16, 16 };
-	int character_size = 20;
+// Sockets of the connections being read, so that serve_socket() can wake
+// them up and wait for them before the pool they push to goes away
+struct OpenConnections {
+	std::mutex mutex;
+	std::condition_variable closed;
+	std::vector<int> fds;
 
-	float trail_dash_time = 0.05f;
-	float trail_gap_time = 0.02f;
+	void add(int fd) {
+		std::lock_guard<std::mutex> lock(mutex);
+		fds.push_back(fd);
+	}
+	void remove(int fd) {
+		std::lock_guard<std::mutex> lock(mutex);
+		fds.erase(std::find(fds.begin(), fds.end(), fd));
+		closed.notify_all();
+	}
+	void close_all() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (int fd : fds) ::shutdown(fd, SHUT_RDWR);
+		closed.wait(lock, [this] { return fds.empty(); });
+	}
+};
 
-	sf::VertexArray prey_trail{ sf::PrimitiveType::Lines };
+int serve_socket(const std::string& path, TaskPool& pool, double max_time) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof address.sun_path) {
+		std::cout << "Socket path is too long: " << path << "\n";
+		return -1;
+	}
+	path.copy(address.sun_path, path.size());
+
+	// a stale socket from an earlier server is replaced, anything else is kept
+	struct stat existing;
+	bool taken = ::lstat(path.c_str(), &existing) == 0;
+	if (taken && S_ISSOCK(existing.st_mode) && ::unlink(path.c_str()) == 0)
+		taken = false;
+	int listener = taken ? -1 : ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0 ||
+		::bind(listener, (sockaddr*)&address, sizeof address) < 0 ||
+		::listen(listener, SOMAXCONN) < 0) {
+		std::cout << "Can't listen on " << path << "\n";
+		if (listener >= 0) ::close(listener);
+		return -1;
+	}
+	OpenConnections connections;
+	while (true) {
+		int fd = ::accept(listener, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			if (errno == EBADF || errno == EINVAL || errno == ENOTSOCK ||
+				errno == EOPNOTSUPP || errno == EFAULT)
+				break;
+			// out of descriptors or memory for now, try again shortly
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+		auto connection = std::make_shared<SocketConnection>(fd);
+		connections.add(fd);
+		try {
+			std::thread([connection, fd, &pool, &connections, max_time] {
+				serve_connection(connection, pool, max_time);
+				connections.remove(fd);
+			}).detach();
+		}
+		catch (std::system_error& e) {
+			connections.remove(fd);
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+	::close(listener);
+	connections.close_all();
+	return -1;
+}
+#endif
+
+int serve(const std::string& socket_path, double max_time) {
+	TaskPool pool(TaskPool::default_threads(), 4 * TaskPool::default_threads());
+	if (socket_path.empty()) {
+		serve_connection(std::make_shared<Connection>(std::cin, std::cout), pool, max_time);
+		pool.finish();
+		return 0;
+	}
+#ifndef _WIN32
+	int result = serve_socket(socket_path, pool, max_time);
+	pool.finish();
+	return result;
+#else
+	std::cout << "Unix sockets are not supported on this platform\n";
+	return -1;
+#endif
+}
 
-	float simulation_timer = 0.f;
+// Splits the front of buffer off into record if it holds a complete
+// "<id> ok|error <n>" response with its n lines.
+bool take_response(std::string& buffer, std::string& record, std::size_t& id) {
+	std::size_t end = buffer.find('\n');
+	if (end == std::string::npos) return false;
+	std::istringstream header(buffer.substr(0, end));
+	std::string status;
+	std::size_t count;
+	if (!(header >> id >> status >> count)) return false;
+	for (; count > 0; --count) {
+		end = buffer.find('\n', end + 1);
+		if (end == std::string::npos) return false;
+	}
+	record = buffer.substr(0, end + 1);
+	buffer.erase(0, end + 1);
+	return true;
+}
 
-	Simulation() {}
-	Simulation(std::istream& file); // declaration because of std::map
+// First line of a checkpoint: a hash of the manifest lines, the step and the
+// time limit, so records aren't reused for different scenarios or settings.
+std::string checkpoint_header(const std::vector<std::string>& manifest,
+	double step, double time_limit) {
+	std::uint64_t hash = 14695981039346656037ull; // FNV-1a
+	for (const std::string& path : manifest) {
+		for (char c : path + '\n') {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+	}
+	std::ostringstream header;
+	header.precision(std::numeric_limits<double>::max_digits10);
+	header << "sweep " << std::hex << hash << std::dec << " step " << step
+		<< " limit " << time_limit << '\n';
+	return header.str();
+}
 
-	void setPreyPosition(vec2 value) {
-		prey_position = value;
-		prey.setPosition(to_vec2f(prey_position));
+#ifndef _WIN32
+bool write_all(int fd, const std::string& data) {
+	for (std::size_t done = 0; done < data.size();) {
+		ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		done += n;
 	}
+	return true;
+}
 
-	void setPreyVelocity(vec2 value) {
-		move_by_plan = false;
-		prey_velocity = normalize(value, prey_speed);
-		align_rotation_to_vec(prey, to_vec2f(prey_velocity));
+// Sweep worker: reads "<first> <last>" ranges of manifest entries and answers
+// each scenario with a response record named by its manifest index. Each
+// scenario stops after time_limit simulated seconds, predators still chasing
+// then have no capture time.
+void sweep_worker(const std::vector<std::string>& manifest, int in, int out,
+	double step, double time_limit) {
+	FdStreamBuf in_buffer(in);
+	std::istream ranges(&in_buffer);
+	std::size_t first, last;
+	while (ranges >> first >> last) {
+		for (std::size_t i = first; i < last; ++i) {
+			std::ostringstream lines;
+			std::ifstream file(manifest[i]);
+			bool ok = file.is_open() && run_scenario(file, lines, step, time_limit);
+			if (!file.is_open()) lines << "Can't open file " << manifest[i] << "\n";
+			if (!write_all(out, Connection::response(std::to_string(i), ok, lines.str())))
+				return;
+		}
 	}
+}
 
-	void rotatePreyVelocity(double rotation) {
-		move_by_plan = false;
-		double angle = prey_velocity == vec2() ? 0 : std::atan2(prey_velocity.y, prey_velocity.x);
-		angle += rotation;
-		prey_velocity = normalize(vec2(std::cos(angle), std::sin(angle)), prey_speed);
-		align_rotation_to_vec(prey, to_vec2f(prey_velocity));
+struct SweepWorker {
+	pid_t pid = -1;
+	int to = -1, from = -1;
+	std::vector<std::size_t> pending; // handed out but not answered yet
+	std::string buffer;
+};
+
+bool start_sweep_worker(SweepWorker& worker, const std::vector<SweepWorker>& pool,
+	const std::vector<std::string>& manifest, double step, double time_limit) {
+	int to[2], from[2];
+	if (::pipe(to) < 0) return false;
+	if (::pipe(from) < 0) {
+		::close(to[0]);
+		::close(to[1]);
+		return false;
+	}
+	std::cout.flush();
+	pid_t pid = ::fork();
+	if (pid == 0) {
+		::close(to[1]);
+		::close(from[0]);
+		// other workers must see end of input when the coordinator closes it
+		for (const SweepWorker& other : pool)
+			if (&other != &worker && other.pid > 0) {
+				::close(other.to);
+				::close(other.from);
+			}
+		sweep_worker(manifest, to[0], from[1], step, time_limit);
+		::_exit(0);
+	}
+	::close(to[0]);
+	::close(from[1]);
+	if (pid < 0) {
+		::close(to[1]);
+		::close(from[0]);
+		return false;
 	}
+	worker = SweepWorker();
+	worker.pid = pid;
+	worker.to = to[1];
+	worker.from = from[0];
+	return true;
+}
 
-	vec2 getPreyPosition() { return prey_position; }
-	vec2 getPreyVelocity() { return normalize(prey_velocity, prey_speed); }
-	vec2 getPredatorPosition(const Predator& predator) { return predator.position; }
-	vec2 getPredatorVelocity(const Predator& predator) { return elapsed_last ? predator.velocity : vec2(); }
+void stop_sweep_worker(SweepWorker& worker) {
+	::close(worker.to);
+	::close(worker.from);
+	::waitpid(worker.pid, nullptr, 0);
+	worker.pid = -1;
+}
 
-	bool is_valid() { return valid; }
+// Coordinator of a sharded sweep over the scenarios listed in manifest_path.
+// Ranges of scenarios go to worker processes over pipes, and every answer is
+// appended to the checkpoint file as soon as it arrives, so a restarted sweep
+// only runs what is missing; a checkpoint of another manifest, step or time
+// limit is refused. Scenarios that keep crashing their worker are
+// recorded as errors. Results are printed in manifest order at the end.
+int sweep(const std::string& manifest_path, const std::string& checkpoint_path,
+	unsigned workers, double step, double time_limit, bool compact) {
+	std::ifstream manifest_file(manifest_path);
+	if (!manifest_file.is_open()) {
+		std::cout << "Can't open file " << manifest_path << "\n";
+		return -1;
+	}
+	std::vector<std::string> manifest;
+	std::string line;
+	while (std::getline(manifest_file, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (!line.empty()) manifest.push_back(line);
+	}
 
-	void applyZoom() {
-		float point_radius = zoom * base_radius;
-		prey.setOrigin(point_radius, point_radius);
-		prey.setRadius(point_radius);
-		for (Predator& predator : predators) {
-			predator.setOrigin(point_radius, point_radius);
-			predator.setRadius(point_radius);
+	// completed records from an earlier run; a torn last record is cut off
+	std::vector<std::string> records(manifest.size());
+	std::size_t done = 0;
+	std::string header = checkpoint_header(manifest, step, time_limit);
+	bool fresh;
+	{
+		std::ifstream checkpoint(checkpoint_path, std::ios::binary);
+		std::string buffer((std::istreambuf_iterator<char>(checkpoint)),
+			std::istreambuf_iterator<char>());
+		std::size_t total = buffer.size(), id;
+		fresh = buffer.find('\n') == std::string::npos;
+		if (fresh)
+			buffer.clear(); // nothing or a torn header
+		else if (buffer.compare(0, header.size(), header) == 0)
+			buffer.erase(0, header.size());
+		else {
+			std::cout << "Checkpoint " << checkpoint_path <<
+				" belongs to another manifest, simulation step or time limit\n";
+			return -1;
+		}
+		std::string record;
+		while (take_response(buffer, record, id))
+			if (id < records.size() && records[id].empty()) {
+				records[id] = record;
+				++done;
+			}
+		if (!buffer.empty()) {
+			std::error_code error;
+			std::filesystem::resize_file(checkpoint_path, total - buffer.size(), error);
+		}
+	}
+	std::ofstream checkpoint(checkpoint_path, std::ios::binary |
+		(fresh ? std::ios::trunc : std::ios::app));
+	if (!checkpoint.is_open()) {
+		std::cout << "Can't open file " << checkpoint_path << "\n";
+		return -1;
+	}
+	if (fresh) checkpoint << header << std::flush;
+
+	std::deque<std::pair<std::size_t, std::size_t>> ranges;
+	std::size_t todo = manifest.size() - done;
+	std::size_t range_size = std::max<std::size_t>(1, todo / (4 * workers));
+	for (std::size_t i = 0; i < manifest.size();) {
+		if (!records[i].empty()) {
+			++i;
+			continue;
 		}
+		std::size_t last = i;
+		while (last < manifest.size() && last - i < range_size && records[last].empty())
+			++last;
+		ranges.emplace_back(i, last);
+		i = last;
 	}
 
-	void singleStepSimulate(float elapsed) { // substeps??
-		if (simulation_timer == 0.f && current_movement->rotating && !std::isnan(current_movement->y)) {
-			prey_velocity = normalize(vec2(
-				std::cos(current_movement->y), std::sin(current_movement->y)), prey_speed);
+	::signal(SIGPIPE, SIG_IGN);
+	std::vector<SweepWorker> pool(std::min<std::size_t>(workers, ranges.size()));
+	std::vector<unsigned> crashes(manifest.size());
+	auto assign = [&](SweepWorker& worker) {
+		if (ranges.empty()) return;
+		std::pair<std::size_t, std::size_t> range = ranges.front();
+		ranges.pop_front();
+		for (std::size_t i = range.first; i < range.second; ++i)
+			worker.pending.push_back(i);
+		write_all(worker.to, std::to_string(range.first) + ' ' +
+			std::to_string(range.second) + '\n');
+	};
+	auto record = [&](std::size_t id, const std::string& text) {
+		records[id] = text;
+		checkpoint << text;
+		checkpoint.flush();
+		++done;
+	};
+	for (SweepWorker& worker : pool) {
+		if (!start_sweep_worker(worker, pool, manifest, step, time_limit)) {
+			std::cout << "Can't start worker process\n";
+			return -1;
 		}
+		assign(worker);
+	}
 
-		elapsed_last = elapsed;
-		
-		for (Predator& predator : predators) {
-			if (predator.when_reached < 0.f && predator_close_to_prey(predator))
-			predator.when_reached = simulation_timer;
-		}
-
-		static float trail_timer = 0.f;
-		static bool trail_gap_now = true;
-
-		// prey control
-		if (move_by_plan) {
-			while (simulation_timer >= time_of_next_movement) {
-				++current_movement;
-				time_of_next_movement += current_movement->duration;
-				if (current_movement->rotating && !std::isnan(current_movement->y)) {
-					prey_velocity = normalize(vec2(
-						std::cos(current_movement->y), std::sin(current_movement->y)), prey_speed);
+	std::vector<pollfd> fds;
+	char buffer[4096];
+	while (done < manifest.size()) {
+		fds.clear();
+		for (SweepWorker& worker : pool)
+			fds.push_back(pollfd{ worker.from, POLLIN, 0 });
+		if (::poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		for (std::size_t w = 0; w < pool.size(); ++w) {
+			if (!fds[w].revents) continue;
+			SweepWorker& worker = pool[w];
+			ssize_t n = ::read(worker.from, buffer, sizeof buffer);
+			if (n < 0 && errno == EINTR) continue;
+			if (n > 0) {
+				worker.buffer.append(buffer, n);
+				std::string text;
+				std::size_t id;
+				while (take_response(worker.buffer, text, id)) {
+					worker.pending.erase(std::remove(
+						worker.pending.begin(), worker.pending.end(), id), worker.pending.end());
+					if (id < records.size() && records[id].empty()) record(id, text);
 				}
+				if (worker.pending.empty()) assign(worker);
+				continue;
 			}
 
-			if (!current_movement->rotating) {
-				prey_velocity = normalize(vec2(
-					current_movement->x, current_movement->y), prey_speed);
-			}
-			else {
-				double angle = std::atan2(prey_velocity.y, prey_velocity.x);
-				angle += elapsed * current_movement->x;
-				prey_velocity = normalize(vec2(
-					std::cos(angle), std::sin(angle)), prey_speed);
+			// the worker died: its first unanswered scenario is the likely
+			// culprit, retry it once alone and the rest as new ranges
+			stop_sweep_worker(worker);
+			if (!worker.pending.empty()) {
+				std::size_t suspect = worker.pending.front();
+				if (++crashes[suspect] > 1)
+					record(suspect, Connection::response(std::to_string(suspect), false,
+						"Worker crashed on " + manifest[suspect] + "\n"));
+				else
+					ranges.emplace_front(suspect, suspect + 1);
+				for (std::size_t i = 1; i < worker.pending.size(); ++i)
+					ranges.emplace_back(worker.pending[i], worker.pending[i] + 1);
 			}
-		}
-
-		for (Predator& predator : predators) {
-			if (predator.when_reached < 0.f) {
-				vec2 naive_direction = naiveDirection(predator);
-				vec2 parallel_direction = parallelDirection(predator);
-				vec2 propnav_direction = predator.lambda * parallel_direction + 
-					((1 - predator.lambda) * naive_direction);
-				vec2 propnav_movement = normalize(propnav_direction, predators_speed * elapsed);
-				predator.position += propnav_movement;
-				predator.velocity = propnav_movement / double(elapsed);
-				align_rotation_to_vec(predator, to_vec2f(propnav_direction));
-				predator.setPosition(to_vec2f(predator.position)); // TODO: OY direction
+			if (!start_sweep_worker(worker, pool, manifest, step, time_limit)) {
+				std::cout << "Can't start worker process\n";
+				return -1;
 			}
+			assign(worker);
 		}
-
-		vec2 prey_movement = normalize(prey_velocity, prey_speed * elapsed);
-
-		prey_position += prey_movement;
-		align_rotation_to_vec(prey, to_vec2f(prey_velocity));
-		prey.setPosition(to_vec2f(prey_position)); // TODO: OY direction
-
-		trail_timer -= elapsed;
-		if (trail_timer < 0.f) {
-			prey_trail.append(sf::Vertex(to_vec2f(prey_position), prey_color));
-			for (Predator& predator : predators)
-				if (predator.when_reached < 0.f)
-					predator.trail.append(sf::Vertex(to_vec2f(predator.position), predator.color));
-			trail_timer += trail_gap_now ? trail_dash_time : trail_gap_time;
-			trail_gap_now = !trail_gap_now;
+	}
+	for (SweepWorker& worker : pool)
+		stop_sweep_worker(worker);
+
+	for (std::size_t i = 0; i < manifest.size(); ++i) {
+		std::istringstream text(records[i]);
+		std::string header, status;
+		std::getline(text, header);
+		std::istringstream(header) >> status >> status;
+		std::cout << manifest[i] << (status == "ok" ? "" : " error") << '\n';
+		while (std::getline(text, line)) {
+			std::istringstream fields(line);
+			std::string lambda, when;
+			if (status == "ok" && !compact && fields >> lambda >> when)
+				std::cout << "Lambda " << lambda << " reached at " << when << '\n';
+			else
+				std::cout << line << '\n';
 		}
-
-		simulation_timer += elapsed;
 	}
-
-	void simulate(float elapsed) {
-		if (substeps <= 0) return;
-		elapsed /= substeps;
-		for (int i = 0; i < substeps; ++i)
-			singleStepSimulate(elapsed);
+	std::cout.flush();
+	return 0;
+}
+#endif
+
+// Reports changes of one file. On Linux inotify watches the file's directory,
+// since editors often replace the file instead of writing to it; elsewhere,
+// or if inotify is unavailable, the modification time is polled.
+class FileWatcher {
+	std::filesystem::path path;
+	std::filesystem::file_time_type last_write;
+#ifdef __linux__
+	int fd = -1;
+#endif
+
+	std::filesystem::file_time_type write_time() const {
+		std::error_code error;
+		return std::filesystem::last_write_time(path, error);
 	}
 
-	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
-		target.draw(prey_trail);
-		for (const Predator& predator : predators)
-			target.draw(predator.trail);
-
-		target.draw(prey);
-		for (const Predator& predator : predators)
-			target.draw(predator);
+public:
+	explicit FileWatcher(const std::string& file_path) : path(file_path) {
+		last_write = write_time();
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		std::filesystem::path directory = path.parent_path();
+		if (fd >= 0 && inotify_add_watch(fd, directory.empty() ? "." : directory.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			close(fd);
+			fd = -1;
+		}
+#endif
 	}
-};
-
-std::map<std::string, bool(Simulation::*)(std::smatch&)> simulation_setters;
-std::map<std::string, bool(Simulation::*)(std::smatch&)> predator_setters;
-
-Simulation::Simulation(std::istream& file) {
-	if (simulation_setters.empty()) {
-		simulation_setters["PreyPosition"] = &Simulation::set_prey_position;
-		simulation_setters["PreySpeed"] = &Simulation::set_prey_speed;
-		simulation_setters["PredatorsSpeed"] = &Simulation::set_predators_speed;
-		simulation_setters["PreyColor"] = &Simulation::set_prey_color;
-		simulation_setters["BackgroundColor"] = &Simulation::set_background_color;
-		simulation_setters["TextColor"] = &Simulation::set_text_color;
-		simulation_setters["CharacterSize"] = &Simulation::set_character_size;
-		simulation_setters["PointRadius"] = &Simulation::set_point_radius;
-		simulation_setters["Trail"] = &Simulation::set_trail;
-		simulation_setters["ScaleSpeed"] = &Simulation::set_scale_speed;
-		simulation_setters["RotationAcceleration"] = &Simulation::set_rotation_acceleration;
-		simulation_setters["Zoom"] = &Simulation::set_zoom;
-	}
-	if (predator_setters.empty()) {
-		predator_setters["Position"] = &Simulation::set_predator_position;
-		predator_setters["Color"] = &Simulation::set_predator_color;
-		predator_setters["Lambda"] = &Simulation::set_lambda;
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	~FileWatcher() {
+#ifdef __linux__
+		if (fd >= 0) close(fd);
+#endif
 	}
 
-	std::string line;
-	std::smatch match;
-	enum class ReadingState {
-		started, predator, control
-	} state = ReadingState::started;
-
-	bool reading_broken = false;
-	int line_num = 0;
-	while (std::getline(file, line)) {
-		++line_num;
-		if (line.back() == '\r') line.pop_back();
-		if (state == ReadingState::started) {
-			if (std::regex_match(line, match, S_re::property)) {
-				try {
-					reading_broken = !((this->*simulation_setters.at(match[1].str()))(match));
-				}
-				catch (std::out_of_range&) {
-					reading_broken = true;
+	// waits up to timeout_ms for the file to change
+	bool wait(int timeout_ms) {
+#ifdef __linux__
+		if (fd >= 0) {
+			pollfd watch{ fd, POLLIN, 0 };
+			if (poll(&watch, 1, timeout_ms) <= 0) return false;
+			alignas(inotify_event) char buffer[4096];
+			bool changed = false;
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof buffer)) > 0) {
+				for (char* p = buffer; p < buffer + length;) {
+					inotify_event* event = reinterpret_cast<inotify_event*>(p);
+					if (event->len && path.filename() == event->name)
+						changed = true;
+					p += sizeof(inotify_event) + event->len;
 				}
-				if (reading_broken)
-					std::cout << "Can't set property \"" <<
-					match[1].str() << "\" to \"" << match[2].str() << "\"\n";
-			}
-			else if (std::regex_match(line, match, S_re::empty_line)) {
-			}
-			else if (std::regex_match(line, match, S_re::predator)) {
-				state = ReadingState::predator;
-				predators.push_back(Predator());
-			}
-			else if (std::regex_match(line, match, S_re::preycontrol)) {
-				state = ReadingState::control;
-			}
-			else {
-				reading_broken = true;
-			}
-		}
-		else if (state == ReadingState::predator) {
-			if (std::regex_match(line, match, S_re::property)) {
-				try {
-					reading_broken = !((this->*predator_setters.at(match[1].str()))(match));
-				}
-				catch (std::out_of_range&) {
-					reading_broken = true;
-				}
-				if (reading_broken)
-					std::cout << "Can't set property \"" <<
-					match[1].str() << "\" to \"" << match[2].str() << "\"\n";
-			}
-			else if (std::regex_match(line, match, S_re::empty_line)) {
-			}
-			else if (std::regex_match(line, match, S_re::predator)) {
-				if (predators.back().color.a == 0) {
-						predators.back().color = sf::Color(
-							255 * predators.back().lambda,
-							255 * (1 - predators.back().lambda),
-							0);
-				}
-				predators.push_back(Predator());
-			}
-			else if (std::regex_match(line, match, S_re::preycontrol)) {
-				state = ReadingState::control;
 			}
-			else {
-				reading_broken = true;
-			}
-			
+			return changed;
 		}
-		else if (state == ReadingState::control) {
-			if (std::regex_match(line, match, S_re::control_value)) {
-				reading_broken = !add_straight_control(match);
-			}
-			else if (std::regex_match(line, match, S_re::rotate_value)) {
-				reading_broken = !add_rotating_control(match);
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+		std::filesystem::file_time_type time = write_time();
+		if (time == last_write) return false;
+		last_write = time;
+		return true;
+	}
+};
+
+// Reloads the scenario in the background whenever its file changes: parses
+// it, simulates the new scenario up to the timer the window is showing (which
+// keeps moving, see follow()) and hands it over through take(). Keyboard
+// turns of the prey are not replayed. A broken file keeps the old scenario.
+class ScenarioReloader {
+	std::string path;
+	double step;
+	std::atomic<double> target{ 0. };
+	std::atomic<bool> closing{ false };
+	std::atomic<bool> reloading{ false };
+	std::mutex mutex;
+	std::unique_ptr<Simulation> ready;
+	std::thread worker;
+
+	void run() {
+		FileWatcher watcher(path);
+		bool changed = false;
+		while (!closing) {
+			if (!changed && !watcher.wait(200)) continue;
+			changed = false;
+			reloading = true;
+			std::ifstream file(path);
+			std::unique_ptr<Simulation> next;
+			if (file.is_open())
+				next = std::make_unique<Simulation>(file);
+			else
+				std::cout << "Can't open file " << path << "\n";
+			if (!next || !next->is_valid()) {
+				reloading = false;
+				continue;
 			}
-			else if (std::regex_match(line, match, S_re::empty_line)) {
+			// catch up with the window, starting over if the file changes again
+			unsigned long long steps = 0;
+			while (!closing && next->simulation_timer + step <= target) {
+				next->singleStepSimulate(step);
+				if (++steps % 4096 == 0 && watcher.wait(0)) {
+					changed = true;
+					break;
+				}
 			}
-			else {
-				reading_broken = true;
+			if (!changed && !closing) {
+				std::lock_guard<std::mutex> lock(mutex);
+				ready = std::move(next);
 			}
+			reloading = false;
 		}
 	}
-	if (reading_broken) {
-		std::cout << "Syntax error at line " << line_num <<" : \"" << line << "\"\n";
-		valid = false;
+
+public:
+	ScenarioReloader(const std::string& path, double step) : path(path), step(step) {
+		worker = std::thread(&ScenarioReloader::run, this);
 	}
-	else if (movements.empty()) {
-		std::cout << "Cannot start without control" << '\n';
-		valid = false;
+	~ScenarioReloader() {
+		closing = true;
+		worker.join();
 	}
-	else {
-		valid = true;
 
-		prey.setPointCount(3);
-		for (Predator& predator : predators)
-			predator.setPointCount(3);
+	// the timer the reloaded scenario should reach
+	void follow(double timer) { target = timer; }
 
-		prey.setFillColor(prey_color);
-		for (Predator& predator : predators) {
-			if (predator.color.a == 0) {
-				predator.color = sf::Color(
-					sf::Uint8(predator.lambda) * 255,
-					sf::Uint8(1. - predator.lambda) * 255,
-					0); // default predator color
-			}
-			predator.setFillColor(predator.color);
-		}
+	bool busy() const { return reloading; }
 
-		prey.setPosition(to_vec2f(prey_position));
-		for (Predator& predator : predators) {
-			predator.setPosition(to_vec2f(predator.position));
-		}
-
-		current_movement = movements.begin();
-		if (!current_movement->rotating)
-			align_rotation_to_vec(prey,
-				sf::Vector2f(current_movement->x, current_movement->y));
-		else if (!std::isnan(current_movement->y))
-			align_rotation_to_vec(prey,
-				sf::Vector2f(std::cos(current_movement->y), std::sin(current_movement->y)));
-
-		movements.rbegin()->duration = HUGE_VAL;
-		time_of_next_movement = movements.front().duration;
+	// the reloaded scenario, if one is ready
+	std::unique_ptr<Simulation> take() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return std::move(ready);
 	}
-}
-
-double len(vec2 v) { return std::sqrt(v.x * v.x + v.y * v.y); }
-
-vec2 new_velocity(float elapsed) {
-	const float speed = 1.f;
-	static float phase = 0.f;
-	phase += elapsed * speed;
-	return { 4. * std::cos(phase), 4. * std::sin(phase) };
-}
+};
 
 void print_usage(const char* progname) {
 	std::cout << "Usage:\n" << 
 	progname << " -h prints this help\n" <<
-	progname << " [-c] [-H [simulation_step]] <file path>\n"
+	progname << " [-c] [-H] [simulation_step] [-P [slices] | -F | -D] [-V] [-M <radii> <output>] [-A] [-E <width>x<height> <fps> <prefix> [seconds]] <file path>\n" <<
+	progname << " -S [socket path] [-L <seconds>]\n" <<
+	progname << " [-c] [simulation_step] [-L <seconds>] -W <workers> <checkpoint> <manifest path>\n"
 	"-H (for headless) runs application without GUI and prints timings for predators\n"
 	"-c (for compact) prints less output (both GUI and headless)\n"
-	"<file path> can be '-', in this case stdin is read for configuration" << std::endl; 
+	"-P (for parareal) runs headless with time slices simulated in parallel\n"
+	"-F (for fast) runs headless in single precision; not with -P or -D\n"
+	"-D (for derivatives) runs headless and follows every capture time with its\n"
+	"   derivatives by the predator's own lambda, start position x and y, PreySpeed\n"
+	"   and PredatorsSpeed; not with -P or -F\n"
+	"-V with -P or -F also runs the plain double precision simulation and reports\n"
+	"   the largest capture time difference\n"
+	"-M (for metrics) records path length, minimum range, peak turn rate, miss distance\n"
+	"   and the first time within each of the comma separated radii for every predator,\n"
+	"   written as CSV or, for an output ending in .bin, as binary columns; not with -P\n"
+	"-A (for aggregates) prints count, mean, min and quantiles of the metrics to stderr\n"
+	"-E (for export) renders frames off-screen to <prefix>NNNNNN.png until all predators\n"
+	"   reach the prey or after the given simulated seconds (600 by default),\n"
+	"   substeps are no longer than simulation_step\n"
+	"-S (for server) answers scenario requests from stdin or a unix socket until closed:\n"
+	"   request \"<id> <length> [step [time limit]]\\n\" followed by <length> bytes of\n"
+	"   configuration (at most 16 MiB) and at most 1e8 steps up to the time limit,\n"
+	"   answer \"<id> ok|error <n>\\n\" followed by n lines\n"
+	"-L (for limit) with -S or -W stops every request or scenario after at most this\n"
+	"   many simulated seconds (3600 by default), also when a request gives no or a\n"
+	"   longer limit; predators still chasing then have no capture time (-1)\n"
+#ifdef PURSUIT_PROFILE
+	"profiling build: headless prints a profile summary to stderr, P toggles it in GUI\n"
+#endif
+	"-W (for sweep) runs every scenario listed in the manifest (one path per line)\n"
+	"   on worker processes, appending results to the checkpoint file as they finish;\n"
+	"   running it again skips scenarios already in the checkpoint, which must come\n"
+	"   from the same manifest, simulation_step and time limit\n"
+	"<file path> can be '-', in this case stdin is read for configuration;\n"
+	"the GUI reloads any other file when it changes, re-simulating up to the\n"
+	"shown time in simulation_step steps;\n"
+	"simulation_step (1e-3 by default) is the step of headless runs, sweeps,\n"
+	"exports and GUI reloads" << std::endl; 
 }
 
 int main(int argc, const char* argv[]) {
 	bool headless = false;
 	bool sim_info_compact = false;
 	bool file_specified = false;
-	float headless_step = 1e-3;
+	double headless_step = 1e-3;
+	bool exporting = false;
+	unsigned export_width = 0, export_height = 0;
+	float export_fps = 0.f;
+	double export_duration = 600.;
+	std::string export_prefix;
+	bool server = false;
+	std::string socket_path;
+	double scenario_time_limit = 3600.;
+	unsigned parareal_slices = 0;
+	bool verify = false;
+	bool fast = false;
+	bool derivatives = false;
+	bool metrics = false;
+	bool metric_aggregates = false;
+	std::vector<double> metric_radii;
+	std::string metrics_path;
+	std::string file_path;
+	unsigned sweep_workers = 0;
+	std::string checkpoint_path;
+	std::string manifest_path;
 	Simulation S;
 
 	for (int i = 1; i < argc; ++i) {
@@ -663,75 +1122,269 @@ int main(int argc, const char* argv[]) {
 		else if (arg == "-H") {
 			headless = true;
 		}
-		else if (arg == "-") {
-			S = Simulation(std::cin);
-			file_specified = true;
+		else if (arg == "-P") {
+			headless = true;
+			parareal_slices = TaskPool::default_threads();
+			if (i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0])
+				&& std::string(argv[i + 1]).find_first_not_of("0123456789") == std::string::npos)
+				parareal_slices = std::stoi(argv[++i]);
+			if (parareal_slices == 0) {
+				print_usage(argv[0]);
+				return -1;
+			}
+		}
+		else if (arg == "-V") {
+			verify = true;
+		}
+		else if (arg == "-F") {
+			headless = true;
+			fast = true;
+		}
+		else if (arg == "-D") {
+			headless = true;
+			derivatives = true;
 		}
-		else if (headless == true) {
+		else if (arg == "-M") {
+			headless = true;
+			metrics = true;
+			if (i + 2 >= argc) {
+				print_usage(argv[0]);
+				return -1;
+			}
+			std::istringstream radii(argv[i + 1]);
+			std::string radius;
+			while (std::getline(radii, radius, ',')) {
+				try {
+					metric_radii.push_back(std::stod(radius));
+				}
+				catch (std::exception& e) {
+					print_usage(argv[0]);
+					return -1;
+				}
+			}
+			metrics_path = argv[i + 2];
+			i += 2;
+		}
+		else if (arg == "-A") {
+			headless = true;
+			metrics = true;
+			metric_aggregates = true;
+		}
+		else if (arg == "-W") {
+			headless = true;
+			if (i + 2 >= argc) {
+				print_usage(argv[0]);
+				return -1;
+			}
 			try {
-				headless_step = std::stof(arg);
+				sweep_workers = std::stoi(argv[i + 1]);
 			}
 			catch (std::exception& e) {
-				std::ifstream file(arg);
-				if (!file.is_open()) {
-					std::cout << "Can't open file " << arg << "\n";
-					return -1;
+				sweep_workers = 0;
+			}
+			if (sweep_workers == 0) {
+				print_usage(argv[0]);
+				return -1;
+			}
+			checkpoint_path = argv[i + 2];
+			i += 2;
+		}
+		else if (arg == "-S") {
+			server = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				socket_path = argv[++i];
+		}
+		else if (arg == "-L") {
+			if (i + 1 >= argc) {
+				print_usage(argv[0]);
+				return -1;
+			}
+			try {
+				scenario_time_limit = std::stod(argv[++i]);
+			}
+			catch (std::exception& e) {
+				scenario_time_limit = 0.;
+			}
+			if (!(scenario_time_limit > 0.)) {
+				print_usage(argv[0]);
+				return -1;
+			}
+		}
+		else if (arg == "-E") {
+			char separator = 0;
+			if (i + 3 >= argc ||
+				std::sscanf(argv[i + 1], "%ux%u%c", &export_width, &export_height, &separator) != 2 ||
+				export_width == 0 || export_height == 0) {
+				print_usage(argv[0]);
+				return -1;
+			}
+			try {
+				export_fps = std::stof(argv[i + 2]);
+			}
+			catch (std::exception& e) {
+				export_fps = 0.f;
+			}
+			if (export_fps <= 0.f) {
+				print_usage(argv[0]);
+				return -1;
+			}
+			export_prefix = argv[i + 3];
+			exporting = true;
+			i += 3;
+			if (i + 1 < argc) {
+				std::size_t parsed = 0;
+				try {
+					double duration = std::stod(argv[i + 1], &parsed);
+					if (argv[i + 1][parsed] == '\0' && duration > 0.) {
+						export_duration = duration;
+						++i;
+					}
 				}
-				S = Simulation(file);
-				file_specified = true;
-			}	
+				catch (std::exception& e) {}
+			}
+		}
+		else if (arg == "-") {
+			file_path = arg;
+			file_specified = true;
 		}
 		else {
-			std::ifstream file(arg);
-			if (!file.is_open()) {
-				std::cout << "Can't open file " << arg << "\n";
-				return -1;
+			// a positive number is the simulation step, anything else the file
+			std::size_t parsed = 0;
+			try {
+				double step = std::stod(arg, &parsed);
+				if (parsed == arg.size() && step > 0.) {
+					headless_step = step;
+					continue;
+				}
 			}
-			S = Simulation(file);
+			catch (std::exception& e) {}
+			if (sweep_workers)
+				manifest_path = arg;
+			else
+				file_path = arg;
 			file_specified = true;
 		}
 	}
+	if (server) {
+		int result = serve(socket_path, scenario_time_limit);
+#ifdef PURSUIT_PROFILE
+		S_prof::summary(std::cerr);
+		std::cerr << std::endl;
+#endif
+		return result;
+	}
+	if (sweep_workers) {
+		if (manifest_path.empty()) {
+			print_usage(argv[0]);
+			return -1;
+		}
+#ifndef _WIN32
+		return sweep(manifest_path, checkpoint_path, sweep_workers,
+			headless_step, scenario_time_limit, sim_info_compact);
+#else
+		std::cout << "Sweeps are not supported on this platform\n";
+		return -1;
+#endif
+	}
 	if (!file_specified) {
-		std::string file_path;
 		std::cout << "Enter file name: ";
 		std::getline(std::cin, file_path);
+	}
+
+	// kept as text so the scenario can be read again in another precision
+	std::string config;
+	if (file_path == "-") {
+		config.assign(std::istreambuf_iterator<char>(std::cin), {});
+	}
+	else {
 		std::ifstream file(file_path);
 		if (!file.is_open()) {
 			std::cout << "Can't open file " << file_path << "\n";
 			return -1;
 		}
+		config.assign(std::istreambuf_iterator<char>(file), {});
+	}
+	{
+		std::istringstream file(config);
 		S = Simulation(file);
 	}
 
 	if (!S.is_valid()) return -1;
 
+	if (exporting) {
+		int result = export_frames(S, export_width, export_height, export_fps,
+			export_prefix, headless_step, export_duration);
+#ifdef PURSUIT_PROFILE
+		S.profile_counters.flush();
+		S_prof::summary(std::cerr);
+		std::cerr << std::endl;
+#endif
+		return result;
+	}
+
+	// one simulation mode at a time, each prints its own results
+	if ((metrics && parareal_slices) || int(fast) + int(derivatives) + int(parareal_slices > 0) > 1) {
+		print_usage(argv[0]);
+		return -1;
+	}
+
 	if (headless) {
-		while (true) {
-			bool done = true;
-			for (Simulation::Predator& predator : S.predators) {
-				if (predator.when_reached < 0.f) {
-					done = false;
-					break;
-				}
+		if (metrics) S.setMetricRadii(metric_radii);
+		if (parareal_slices) {
+			Simulation serial = verify ? S : Simulation();
+			PararealReport report = simulate_parareal(S, headless_step, parareal_slices);
+			std::cerr << "Parareal: " << report.slices << " slices in " << report.windows
+				<< " windows up to " << report.horizon << ", " << report.iterations
+				<< " iterations, last defect " << report.defect << '\n';
+			if (report.serial_windows)
+				std::cerr << "Parareal: " << report.serial_windows << " of " << report.windows
+					<< " windows needed every iteration and ran no faster than serial\n";
+			if (verify) {
+				serial.simulateUntilReached(headless_step);
+				std::cerr << "Largest capture time difference from serial run: "
+					<< capture_difference(S, serial) << '\n';
 			}
-			if (done) break;
-			S.simulate(headless_step);
 		}
-		for (Simulation::Predator& predator : S.predators) {
-			if (sim_info_compact) {
-				std::cout << predator.lambda << ' ' << predator.when_reached << std::endl;
-			}
-			else {
-				std::cout << "Lambda " << predator.lambda 
-					<< " reached at " << predator.when_reached << std::endl;
+		else if (derivatives) {
+			std::istringstream file(config);
+			SimulationD D(file, std::cerr);
+			seed_sensitivities(D);
+			if (metrics) D.setMetricRadii(std::vector<SimulationD::real>(metric_radii.begin(), metric_radii.end()));
+			D.simulateUntilReached(headless_step);
+			print_sensitivities(std::cout, D, sim_info_compact);
+			if (metrics && !report_metrics(D, metrics_path, metric_aggregates)) return -1;
+		}
+		else if (fast) {
+			std::istringstream file(config);
+			SimulationF F(file, std::cerr);
+			if (metrics) F.setMetricRadii(std::vector<float>(metric_radii.begin(), metric_radii.end()));
+			F.simulateUntilReached(headless_step);
+			print_results(std::cout, F, sim_info_compact);
+			if (metrics && !report_metrics(F, metrics_path, metric_aggregates)) return -1;
+			if (verify) {
+				S.simulateUntilReached(headless_step);
+				std::cerr << "Largest capture time difference from double precision run: "
+					<< capture_difference(F, S) << '\n';
 			}
 		}
+		else {
+			S.simulateUntilReached(headless_step);
+		}
+		if (!fast && !derivatives) {
+			print_results(std::cout, S, sim_info_compact);
+			if (metrics && !report_metrics(S, metrics_path, metric_aggregates)) return -1;
+		}
+		std::cout.flush();
+#ifdef PURSUIT_PROFILE
+		S.profile_counters.flush();
+		S_prof::summary(std::cerr);
+		std::cerr << std::endl;
+#endif
 	}
 
 
 	else {
 
-		const unsigned int DEF_WIN_X = 1280, DEF_WIN_Y = 720; // default window size
 		sf::Font font;
 		if (!font.loadFromFile("resources/arial.ttf"))
 		{
@@ -763,6 +1416,13 @@ int main(int argc, const char* argv[]) {
 		bool RMB_pressed = false;
 		bool ctrl_pressed = false;
 		bool running = false;
+#ifdef PURSUIT_PROFILE
+		bool show_profile = false;
+#endif
+
+		std::unique_ptr<ScenarioReloader> reloader;
+		if (file_path != "-")
+			reloader = std::make_unique<ScenarioReloader>(file_path, headless_step);
 
 		sf::Clock clock;
 
@@ -785,6 +1445,11 @@ int main(int argc, const char* argv[]) {
 					case sf::Keyboard::Space:
 						running = !running;
 					break;
+#ifdef PURSUIT_PROFILE
+					case sf::Keyboard::P:
+						show_profile = !show_profile;
+					break;
+#endif
 					case sf::Keyboard::LControl:
 						if (!sf::Mouse::isButtonPressed(sf::Mouse::Right))
 							ctrl_pressed = true;
@@ -883,6 +1548,19 @@ int main(int argc, const char* argv[]) {
 			if (running) {
 				S.simulate(elapsed);
 			}
+			if (reloader) {
+				// the edited scenario takes over where the view and the controls are
+				if (std::unique_ptr<Simulation> next = reloader->take()) {
+					next->time_scale = S.time_scale;
+					next->substeps = S.substeps;
+					next->zoom = S.zoom;
+					next->prey_rotation_speed = S.prey_rotation_speed;
+					S = std::move(*next);
+					sim_info.setCharacterSize(S.character_size);
+					sim_info.setFillColor(S.text_color);
+				}
+				reloader->follow(S.simulation_timer);
+			}
 			S.applyZoom();
 			
 			std::stringstream ss_sim_info;
@@ -894,6 +1572,8 @@ int main(int argc, const char* argv[]) {
 << ")\nPrey position: (" << S.getPreyPosition().x << ", " << -S.getPreyPosition().y
 << ")\nPrey velocity: (" << S.getPreyVelocity().x << ", " << -S.getPreyVelocity().y
 << ")\nPrey speed: " << len(S.getPreyVelocity());
+			if (reloader && reloader->busy())
+				ss_sim_info << "\nReloading scenario";
 			int predator_num = 0;
 			for (Simulation::Predator& predator : S.predators) {
 				++predator_num;
@@ -918,13 +1598,24 @@ ss_sim_info << "\nPredator " << predator_num
 				}
 			}
 
+#ifdef PURSUIT_PROFILE
+			if (show_profile) {
+				ss_sim_info << "\n\nProfile:\n";
+				S.profile_counters.flush();
+				S_prof::summary(ss_sim_info);
+			}
+#endif
+
 			sim_info.setString(ss_sim_info.str().c_str());
-			window.clear(S.background_color);
-			window.setView(sim_view);
-			window.draw(S);
-			window.setView(text_view);
-			window.draw(sim_info);
-			window.display();
+			{
+				PROFILE_SCOPE(render);
+				window.clear(S.background_color);
+				window.setView(sim_view);
+				window.draw(S);
+				window.setView(text_view);
+				window.draw(sim_info);
+				window.display();
+			}
 		}
 	}
 	return 0;
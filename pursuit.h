@@ -0,0 +1,54 @@
+/* Embeddable pursuit simulation library.
+ *
+ * Every pursuit_simulation is independent, so different instances can be
+ * used from different threads at the same time; a single instance must not
+ * be used from two threads at once. Link with libpursuit.a or libpursuit.so
+ * and SFML (graphics, window, system). */
+#ifndef PURSUIT_H
+#define PURSUIT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PURSUIT_API_VERSION 1
+
+typedef struct pursuit_simulation pursuit_simulation;
+
+/* PURSUIT_API_VERSION the library was built with */
+int pursuit_api_version(void);
+
+/* Reads a scenario in the configuration file format. Returns NULL if it is
+ * invalid; parser messages are then copied, NUL-terminated, into errors
+ * when errors_size is not zero. Trails are not recorded. */
+pursuit_simulation* pursuit_load(const char* config, size_t length,
+	char* errors, size_t errors_size);
+
+void pursuit_free(pursuit_simulation* simulation);
+
+/* advances the simulation by one step of the given length */
+void pursuit_step(pursuit_simulation* simulation, double step);
+
+/* Steps until every predator reaches the prey or the simulation time reaches
+ * time_limit (<= 0 for no limit). Returns 1 if every predator was reached. */
+int pursuit_run(pursuit_simulation* simulation, double step, double time_limit);
+
+double pursuit_time(const pursuit_simulation* simulation);
+void pursuit_prey_position(const pursuit_simulation* simulation, double* x, double* y);
+
+size_t pursuit_predator_count(const pursuit_simulation* simulation);
+/* predators still chasing the prey */
+size_t pursuit_active_count(const pursuit_simulation* simulation);
+double pursuit_predator_lambda(const pursuit_simulation* simulation, size_t i);
+void pursuit_predator_position(const pursuit_simulation* simulation, size_t i,
+	double* x, double* y);
+/* time the predator reached the prey, negative while still chasing */
+double pursuit_when_reached(const pursuit_simulation* simulation, size_t i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+#include "pursuit.h"
+#include "simulation.hpp"
+#include <sstream>
+#include <cstring>
+
+struct pursuit_simulation {
+	Simulation S;
+};
+
+int pursuit_api_version(void) {
+	return PURSUIT_API_VERSION;
+}
+
+pursuit_simulation* pursuit_load(const char* config, size_t length,
+	char* errors, size_t errors_size) {
+	try {
+		std::istringstream file(std::string(config, length));
+		std::ostringstream log;
+		pursuit_simulation* simulation = new pursuit_simulation{ Simulation(file, log) };
+		if (simulation->S.is_valid()) {
+			simulation->S.record_trails = false;
+			return simulation;
+		}
+		delete simulation;
+		if (errors_size) {
+			std::string message = log.str();
+			std::size_t count = std::min(message.size(), errors_size - 1);
+			std::memcpy(errors, message.data(), count);
+			errors[count] = '\0';
+		}
+	}
+	catch (std::exception&) {
+		if (errors_size) errors[0] = '\0';
+	}
+	return nullptr;
+}
+
+void pursuit_free(pursuit_simulation* simulation) {
+	delete simulation;
+}
+
+void pursuit_step(pursuit_simulation* simulation, double step) {
+	simulation->S.singleStepSimulate(step);
+}
+
+int pursuit_run(pursuit_simulation* simulation, double step, double time_limit) {
+	simulation->S.simulateUntilReached(step, time_limit);
+	return simulation->S.all_reached();
+}
+
+double pursuit_time(const pursuit_simulation* simulation) {
+	return simulation->S.simulation_timer;
+}
+
+void pursuit_prey_position(const pursuit_simulation* simulation, double* x, double* y) {
+	vec2 position = simulation->S.getPreyPosition();
+	*x = position.x;
+	*y = position.y;
+}
+
+size_t pursuit_predator_count(const pursuit_simulation* simulation) {
+	return simulation->S.predators.size();
+}
+
+size_t pursuit_active_count(const pursuit_simulation* simulation) {
+	return simulation->S.active_count();
+}
+
+double pursuit_predator_lambda(const pursuit_simulation* simulation, size_t i) {
+	return simulation->S.predators[i].lambda;
+}
+
+void pursuit_predator_position(const pursuit_simulation* simulation, size_t i,
+	double* x, double* y) {
+	*x = simulation->S.predators[i].position.x;
+	*y = simulation->S.predators[i].position.y;
+}
+
+double pursuit_when_reached(const pursuit_simulation* simulation, size_t i) {
+	return simulation->S.predators[i].when_reached;
+}
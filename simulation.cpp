@@ -0,0 +1,623 @@
+#include "simulation.hpp"
+#include "profile.hpp"
+
+// Parser patterns, built on first use so that a Simulation read during
+// another translation unit's static initialization finds them ready
+namespace {
+struct SimulationPatterns {
+	const std::regex property{"\\s*([_a-zA-Z0-9]+)\\s*=\\s*(.+?)(?:;.*)?"};
+	const std::regex empty_line{"\\s*(?:;.*)?"};
+	const std::regex preycontrol{"\\s*PreyControl:\\s*?(?:;.*)?"};
+	const std::regex predator{"\\s*Predator:\\s*?(?:;.*)?"};
+	const std::regex control_value{
+		"\\s*(-?\\d+(?:\\.\\d*)?)"
+		"\\s*(-?\\d+(?:\\.\\d*)?)"
+		"\\s*(\\d+(?:\\.\\d*)?)?"
+		"\\s*(?:;.*)?"
+	}; // u.x, u.y, duration
+	const std::regex rotate_value{
+		"\\s*rotate"
+		"\\s*(-?\\d+(?:\\.\\d*)?d?)"
+		"\\s*(\\d+(?:\\.\\d*)?d?)?"
+		"\\s*(-?\\d+(?:\\.\\d*)?d?)?" // d?
+		"\\s*(?:;.*)?"
+	}; // rotate, rotation speed, duration, starting rotation
+	const std::regex flee_value{
+		"\\s*flee"
+		"\\s*(\\d+(?:\\.\\d*)?)?"
+		"\\s*(?:;.*)?"
+	}; // flee, duration
+	const std::regex evasive_value{
+		"\\s*(dodge|spiral)"
+		"\\s+(-?\\d+(?:\\.\\d*)?d?)"
+		"\\s*(\\d+(?:\\.\\d*)?)?"
+		"\\s*(?:;.*)?"
+	}; // dodge, time to go threshold, duration or spiral, angle, duration
+
+	const std::regex numbers{
+		"(-?\\d+(?:\\.\\d*)?)\\s*"
+		"(?:,\\s*(-?\\d+(?:\\.\\d*)?)\\s*)?"
+		"(?:,\\s*(-?\\d+(?:\\.\\d*)?)\\s*)?"
+	};
+};
+
+const SimulationPatterns& S_re() {
+	static const SimulationPatterns patterns;
+	return patterns;
+}
+}
+
+template <class Real>
+bool BasicSimulation<Real>::match_number_count(
+	const std::string& str, std::smatch& number_match, int count
+) {
+	bool can_be_neg = count < 0;
+	if (can_be_neg) count = -count;
+	if (!std::regex_match(str, number_match, S_re().numbers))
+		return false;
+	if (number_match[count + 1].length() || !number_match[count].length())
+		return false;
+	if (!can_be_neg)
+		for (int i = 1; i <= count; ++i)
+			if (*number_match[i].str().begin() == '-')
+				return false;
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_prey_position(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, -2))
+		return false;
+	prey_position = vec2(std::stod(i_match[1]), std::stod(i_match[2]));
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_predator_position(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, -2))
+		return false;
+	predators.back().position = vec2(std::stod(i_match[1]), std::stod(i_match[2]));
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_prey_speed(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	prey_speed = std::stod(i_match[1]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_predators_speed(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	predators_speed = std::stod(i_match[1]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_prey_color(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 3))
+		return false;
+	prey_color = sf::Color(
+		std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_predator_color(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 3))
+		return false;
+	predators.back().color = sf::Color(
+		std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_lambda(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	predators.back().lambda = std::stod(i_match[1]);
+	return predators.back().lambda >= 0 && 
+		predators.back().lambda <= 1;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_background_color(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 3))
+		return false;
+	background_color = sf::Color(
+		std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_text_color(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 3))
+		return false;
+	text_color = sf::Color(
+		std::stoi(i_match[1]), std::stoi(i_match[2]), std::stoi(i_match[3]));
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_character_size(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	character_size = std::stoi(i_match[1]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_point_radius(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	base_radius = std::stod(i_match[1]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_trail(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 2))
+		return false;
+	trail_dash_time = std::stod(i_match[1]);
+	trail_gap_time = std::stod(i_match[2]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_zoom(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	zoom = std::stod(i_match[1]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_scale_speed(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	scale_speed = std::stod(i_match[1]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::set_rotation_acceleration(std::smatch& match) {
+	std::smatch i_match;
+	const std::string& str = match[2].str();
+	if (!match_number_count(str, i_match, 1))
+		return false;
+	prey_rotation_acceleration = std::stod(i_match[1]);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::add_straight_control(std::smatch& match) {
+	if (!movements.empty() && movements.back().duration == 0.) {
+		movements.pop_back();
+	}
+	double dur = match[3].length() ? std::stod(match[3]) : 0.;
+	movements.emplace_back(Movement::straight,
+		std::stod(match[1]), std::stod(match[2]), dur);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::add_rotating_control(std::smatch& match) {
+	if (!movements.empty() && movements.back().duration == 0.) {
+		movements.pop_back();
+	}
+	if (!match[2].str().empty() && *match[2].str().rbegin() == 'd')
+		return false;
+
+	double speed = std::stod(match[1]);
+	if (*match[1].str().rbegin() == 'd')
+		speed = speed * PI / 180.;
+	double dur = match[2].length() ? std::stod(match[2]) : 0.;
+	double start = match[3].length() ? std::stod(match[3]) : std::nan("");
+	if (match[3].length() != 0 && *match[3].str().rbegin() == 'd')
+		start = start * PI / 180.;
+	if (movements.empty() && !std::isnan(start))
+		align_rotation_to_vec(prey,
+			sf::Vector2f(std::cos(start), std::sin(start)));
+
+	movements.emplace_back(Movement::rotating,
+		speed, start, dur);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::add_flee_control(std::smatch& match) {
+	if (!movements.empty() && movements.back().duration == 0.) {
+		movements.pop_back();
+	}
+	double dur = match[1].length() ? std::stod(match[1]) : 0.;
+	movements.emplace_back(Movement::flee, 0., 0., dur);
+	return true;
+}
+
+template <class Real>
+bool BasicSimulation<Real>::add_evasive_control(std::smatch& match) {
+	if (!movements.empty() && movements.back().duration == 0.) {
+		movements.pop_back();
+	}
+	bool dodge = match[1].str() == "dodge";
+	double value = std::stod(match[2]);
+	if (*match[2].str().rbegin() == 'd') {
+		if (dodge) return false;
+		value = value * PI / 180.;
+	}
+	if (dodge && value < 0)
+		return false;
+	double dur = match[3].length() ? std::stod(match[3]) : 0.;
+	movements.emplace_back(dodge ? Movement::dodge : Movement::spiral,
+		value, 0., dur);
+	return true;
+}
+
+template <class Real>
+void BasicSimulation<Real>::react(const Movement& movement, Real elapsed) {
+	if (active.empty()) return; // nothing to run from, keep going
+	using std::cos; using std::sin;
+	Threat threat = observeThreat();
+	// within one predator step turning only makes the prey jitter in place
+	if (threat.nearest_range <= predators_speed * elapsed && prey_velocity != vec2())
+		return;
+	vec2 away = -threat.direction;
+	switch (movement.kind) {
+	case Movement::flee:
+		prey_velocity = normalize(away, prey_speed);
+	break;
+	case Movement::dodge:
+		if (prey_velocity == vec2()) {
+			prey_velocity = normalize(away, prey_speed);
+		}
+		else if (threat.time_to_go < movement.x) {
+			// break across the line of sight, against the nearest predator's motion
+			const Predator& nearest = predators[threat.nearest];
+			vec2 line_of_sight = nearest.position - prey_position;
+			vec2 across(-line_of_sight.y, line_of_sight.x);
+			if (dot_product(across, getPredatorVelocity(nearest)) > 0)
+				across = -across;
+			prey_velocity = normalize(across, prey_speed);
+		}
+	break;
+	case Movement::spiral: {
+		Real c = cos(movement.x), s = sin(movement.x);
+		prey_velocity = normalize(vec2(away.x * c - away.y * s,
+			away.x * s + away.y * c), prey_speed);
+	}
+	break;
+	default: break;
+	}
+}
+
+template <class Real>
+void BasicSimulation<Real>::singleStepSimulate(Real elapsed) { // substeps??
+	using std::sqrt; using std::cos; using std::sin; using std::atan2; using std::abs; using std::isnan;
+	PROFILE_STEP();
+	PROFILE_STEP_SCOPE(simulate);
+	if (simulation_timer == 0.f && movements[current_movement].kind == Movement::rotating && !isnan(movements[current_movement].y)) {
+		prey_velocity = normalize(vec2(
+			cos(movements[current_movement].y), sin(movements[current_movement].y)), prey_speed);
+	}
+
+	elapsed_last = elapsed;
+	
+	{
+		PROFILE_STEP_SCOPE(capture);
+		for (std::size_t i = 0; i < active.size();) {
+			Predator& predator = predators[active[i]];
+			Real range = distance(prey_position, predator.position);
+			if (record_metrics) update_range_metrics(predator, range);
+			// a predator circling the prey at close range may end up moving away
+			// in the capture step, its capture time then follows the approach
+			if (range >= 2 * predators_speed * elapsed_last)
+				predator.closing_time = -1;
+			else if (predator.closing_time < 0)
+				predator.closing_time = capture_time(predator, range);
+			if (close_to_prey(range)) {
+				Real closing_time = capture_time(predator, range);
+				predator.when_reached = with_derivatives(simulation_timer,
+					closing_time >= 0 ? closing_time : predator.closing_time);
+				active[i] = active.back();
+				active.pop_back();
+			}
+			else ++i;
+		}
+	}
+
+	// prey control
+	if (move_by_plan) {
+		PROFILE_STEP_SCOPE(plan);
+		while (simulation_timer >= time_of_next_movement) {
+			++current_movement;
+			time_of_next_movement += movements[current_movement].duration;
+			if (movements[current_movement].kind == Movement::rotating && !isnan(movements[current_movement].y)) {
+				prey_velocity = normalize(vec2(
+					cos(movements[current_movement].y), sin(movements[current_movement].y)), prey_speed);
+			}
+		}
+
+		if (movements[current_movement].kind == Movement::straight) {
+			prey_velocity = normalize(vec2(
+				movements[current_movement].x, movements[current_movement].y), prey_speed);
+		}
+		else if (movements[current_movement].kind == Movement::rotating) {
+			Real angle = atan2(prey_velocity.y, prey_velocity.x);
+			angle += elapsed * movements[current_movement].x;
+			prey_velocity = normalize(vec2(
+				cos(angle), sin(angle)), prey_speed);
+		}
+		else {
+			react(movements[current_movement], elapsed);
+		}
+	}
+
+	{
+		PROFILE_STEP_SCOPE(guidance);
+		PROFILE_STEP_COUNT(active_predators, active.size());
+		for (std::size_t i : active) {
+			Predator& predator = predators[i];
+			vec2 naive_direction = naiveDirection(predator);
+			vec2 parallel_direction = parallelDirection(predator);
+			vec2 propnav_direction = predator.lambda * parallel_direction + 
+				((1 - predator.lambda) * naive_direction);
+			vec2 propnav_movement = normalize(propnav_direction, predators_speed * elapsed);
+			if (record_metrics) {
+				predator.path_length += sqrt(dot_product(propnav_movement, propnav_movement));
+				if (predator.velocity != vec2() && propnav_movement != vec2()) {
+					vec2 v = predator.velocity;
+					vec2 m = propnav_movement;
+					Real turn_rate = abs(atan2(v.x * m.y - v.y * m.x,
+						dot_product(v, m))) / elapsed;
+					predator.peak_turn_rate = std::max(predator.peak_turn_rate, turn_rate);
+				}
+			}
+			predator.position += propnav_movement;
+			predator.velocity = propnav_movement / elapsed;
+			align_rotation_to_vec(predator, to_vec2f(propnav_direction));
+			predator.setPosition(to_vec2f(predator.position)); // TODO: OY direction
+		}
+	}
+
+	{
+		PROFILE_STEP_SCOPE(prey);
+		vec2 prey_movement = normalize(prey_velocity, prey_speed * elapsed);
+
+		prey_position += prey_movement;
+		align_rotation_to_vec(prey, to_vec2f(prey_velocity));
+		prey.setPosition(to_vec2f(prey_position)); // TODO: OY direction
+	}
+
+	if (record_trails) trail_timer -= elapsed;
+	if (trail_timer < 0.f) {
+		PROFILE_STEP_SCOPE(trail);
+		prey_trail.append(sf::Vertex(to_vec2f(prey_position), prey_color));
+		PROFILE_STEP_COUNT(trail_vertices, 1 + active.size());
+		for (std::size_t i : active)
+			predators[i].trail.append(sf::Vertex(
+				to_vec2f(predators[i].position), predators[i].color));
+		trail_timer += trail_on_gap ? trail_dash_time : trail_gap_time;
+		trail_on_gap = !trail_on_gap;
+	}
+
+	simulation_timer += elapsed;
+}
+
+template <class Real>
+void BasicSimulation<Real>::simulate(Real elapsed) {
+	if (substeps <= 0) return;
+	elapsed /= substeps;
+	for (int i = 0; i < substeps; ++i)
+		singleStepSimulate(elapsed);
+}
+
+template <class Real>
+void BasicSimulation<Real>::simulateUntilReached(Real step, Real time_limit) {
+	while (!all_reached() && (time_limit <= 0.f || simulation_timer < time_limit))
+		simulate(step);
+}
+
+// function-local, so built on first use wherever the first Simulation is read
+template <class Real>
+const std::map<std::string, typename BasicSimulation<Real>::Setter>&
+BasicSimulation<Real>::simulation_setters() {
+	static const std::map<std::string, Setter> setters{
+		{ "PreyPosition", &BasicSimulation<Real>::set_prey_position },
+		{ "PreySpeed", &BasicSimulation<Real>::set_prey_speed },
+		{ "PredatorsSpeed", &BasicSimulation<Real>::set_predators_speed },
+		{ "PreyColor", &BasicSimulation<Real>::set_prey_color },
+		{ "BackgroundColor", &BasicSimulation<Real>::set_background_color },
+		{ "TextColor", &BasicSimulation<Real>::set_text_color },
+		{ "CharacterSize", &BasicSimulation<Real>::set_character_size },
+		{ "PointRadius", &BasicSimulation<Real>::set_point_radius },
+		{ "Trail", &BasicSimulation<Real>::set_trail },
+		{ "ScaleSpeed", &BasicSimulation<Real>::set_scale_speed },
+		{ "RotationAcceleration", &BasicSimulation<Real>::set_rotation_acceleration },
+		{ "Zoom", &BasicSimulation<Real>::set_zoom },
+	};
+	return setters;
+}
+
+template <class Real>
+const std::map<std::string, typename BasicSimulation<Real>::Setter>&
+BasicSimulation<Real>::predator_setters() {
+	static const std::map<std::string, Setter> setters{
+		{ "Position", &BasicSimulation<Real>::set_predator_position },
+		{ "Color", &BasicSimulation<Real>::set_predator_color },
+		{ "Lambda", &BasicSimulation<Real>::set_lambda },
+	};
+	return setters;
+}
+
+template <class Real>
+BasicSimulation<Real>::BasicSimulation(std::istream& file, std::ostream& log) {
+	PROFILE_SCOPE(parse);
+
+	std::string line;
+	std::smatch match;
+	enum class ReadingState {
+		started, predator, control
+	} state = ReadingState::started;
+
+	bool reading_broken = false;
+	int line_num = 0;
+	while (std::getline(file, line)) {
+		++line_num;
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (state == ReadingState::started) {
+			if (std::regex_match(line, match, S_re().property)) {
+				try {
+					reading_broken = !((this->*simulation_setters().at(match[1].str()))(match));
+				}
+				catch (std::out_of_range&) {
+					reading_broken = true;
+				}
+				if (reading_broken)
+					log << "Can't set property \"" <<
+					match[1].str() << "\" to \"" << match[2].str() << "\"\n";
+			}
+			else if (std::regex_match(line, match, S_re().empty_line)) {
+			}
+			else if (std::regex_match(line, match, S_re().predator)) {
+				state = ReadingState::predator;
+				predators.push_back(Predator());
+			}
+			else if (std::regex_match(line, match, S_re().preycontrol)) {
+				state = ReadingState::control;
+			}
+			else {
+				reading_broken = true;
+			}
+		}
+		else if (state == ReadingState::predator) {
+			if (std::regex_match(line, match, S_re().property)) {
+				try {
+					reading_broken = !((this->*predator_setters().at(match[1].str()))(match));
+				}
+				catch (std::out_of_range&) {
+					reading_broken = true;
+				}
+				if (reading_broken)
+					log << "Can't set property \"" <<
+					match[1].str() << "\" to \"" << match[2].str() << "\"\n";
+			}
+			else if (std::regex_match(line, match, S_re().empty_line)) {
+			}
+			else if (std::regex_match(line, match, S_re().predator)) {
+				if (predators.back().color.a == 0) {
+						predators.back().color = sf::Color(
+							255 * double(predators.back().lambda),
+							255 * (1 - double(predators.back().lambda)),
+							0);
+				}
+				predators.push_back(Predator());
+			}
+			else if (std::regex_match(line, match, S_re().preycontrol)) {
+				state = ReadingState::control;
+			}
+			else {
+				reading_broken = true;
+			}
+			
+		}
+		else if (state == ReadingState::control) {
+			if (std::regex_match(line, match, S_re().control_value)) {
+				reading_broken = !add_straight_control(match);
+			}
+			else if (std::regex_match(line, match, S_re().rotate_value)) {
+				reading_broken = !add_rotating_control(match);
+			}
+			else if (std::regex_match(line, match, S_re().flee_value)) {
+				reading_broken = !add_flee_control(match);
+			}
+			else if (std::regex_match(line, match, S_re().evasive_value)) {
+				reading_broken = !add_evasive_control(match);
+			}
+			else if (std::regex_match(line, match, S_re().empty_line)) {
+			}
+			else {
+				reading_broken = true;
+			}
+		}
+	}
+	if (reading_broken) {
+		log << "Syntax error at line " << line_num <<" : \"" << line << "\"\n";
+		valid = false;
+	}
+	else if (movements.empty()) {
+		log << "Cannot start without control" << '\n';
+		valid = false;
+	}
+	else {
+		valid = true;
+
+		prey.setPointCount(3);
+		for (Predator& predator : predators)
+			predator.setPointCount(3);
+
+		prey.setFillColor(prey_color);
+		for (Predator& predator : predators) {
+			if (predator.color.a == 0) {
+				predator.color = sf::Color(
+					sf::Uint8(double(predator.lambda)) * 255,
+					sf::Uint8(1. - double(predator.lambda)) * 255,
+					0); // default predator color
+			}
+			predator.setFillColor(predator.color);
+		}
+
+		prey.setPosition(to_vec2f(prey_position));
+		for (std::size_t i = 0; i < predators.size(); ++i) {
+			predators[i].setPosition(to_vec2f(predators[i].position));
+			active.push_back(i);
+		}
+
+		current_movement = 0;
+		using std::cos; using std::sin; using std::isnan;
+		if (movements[current_movement].kind == Movement::straight)
+			align_rotation_to_vec(prey,
+				to_vec2f(vec2(movements[current_movement].x, movements[current_movement].y)));
+		else if (movements[current_movement].kind == Movement::rotating &&
+			!isnan(movements[current_movement].y))
+			align_rotation_to_vec(prey,
+				to_vec2f(vec2(cos(movements[current_movement].y), sin(movements[current_movement].y))));
+
+		movements.rbegin()->duration = HUGE_VAL;
+		time_of_next_movement = movements.front().duration;
+	}
+}
+
+template class BasicSimulation<float>;
+template class BasicSimulation<double>;
+template class BasicSimulation<Dual<sensitivity_count>>;
@@ -0,0 +1,388 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <iostream>
+#include <regex>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include "dual.hpp"
+#include "profile.hpp"
+
+const double PI = 3.1415926535897932;
+typedef sf::Vector2<double> vec2;
+
+// Real is the precision of the whole simulation: positions, speeds, the timer
+// and capture times. Simulation (double) is the reference, SimulationF (float)
+// halves the memory traffic of the step loop at some cost in accuracy,
+// SimulationD carries derivatives of everything with respect to seeded
+// parameters. Math calls are unqualified after "using std::..." so that the
+// dual number overloads are found.
+template <class Real>
+class BasicSimulation : public sf::Drawable {
+
+public:
+	typedef Real real;
+	typedef sf::Vector2<Real> vec2;
+
+	struct Predator : sf::CircleShape {
+		Real lambda = 0;
+		vec2 position;
+		vec2 velocity;
+		sf::Color color {0, 0, 0, 0}; 
+		//zero opacity for further default initialization
+		sf::VertexArray trail{ sf::PrimitiveType::Lines };
+		Real when_reached = -1;
+		Real closing_time = -1; // capture_time() when the prey came within reach
+
+		// engagement metrics, updated while record_metrics is set
+		Real path_length = 0;
+		Real min_range = -1;
+		Real range = -1; // at the last capture check
+		Real peak_turn_rate = 0;
+		std::vector<Real> time_within; // first time inside each of metric_radii, -1 if never
+		std::size_t radii_passed = 0;
+	};
+	
+	std::vector<Predator> predators;
+
+private:
+	// indices of predators not reached yet, compacted as they reach the prey
+	std::vector<std::size_t> active;
+
+	struct Movement {
+		enum Kind {
+			straight, // x, y: direction
+			rotating, // x: rotation speed, y: starting direction
+			flee, // away from the threat direction
+			dodge, // x: time to go that triggers a break turn
+			spiral // x: angle kept from the flee direction
+		} kind;
+		Real x;
+		Real y;
+		Real duration;
+		Movement(Kind kind, Real x, Real y, Real duration)
+			: kind(kind), x(x), y(y), duration(duration) {}
+	};
+
+	std::vector<Movement> movements;
+	std::size_t current_movement = 0;
+	Real time_of_next_movement = 0.;
+
+	sf::CircleShape prey;
+
+	vec2 prey_position{ 0, 0 };
+	vec2 prey_velocity{ 0, 0 };
+
+	Real trail_timer = 0;
+	bool trail_on_gap = true;
+	bool move_by_plan = true;
+
+	Real elapsed_last = 0;
+
+#ifdef PURSUIT_PROFILE
+public:
+	S_prof::StepCounters profile_counters;
+private:
+#endif
+
+	bool valid = false;
+
+	static sf::Vector2f to_vec2f(vec2 v) {
+		return sf::Vector2f{ (float)v.x, (float)v.y };
+	}
+
+	static Real dot_product(vec2 z, vec2 v) {
+		return z.x * v.x + z.y * v.y;
+	}
+
+	static Real distance(vec2 a, vec2 b) {
+		using std::sqrt;
+		vec2 r = a - b;
+		return sqrt(dot_product(r, r));
+	}
+
+	static vec2 normalize(vec2 v, Real target_length) {
+		using std::sqrt;
+		if (v == vec2()) return v;
+		Real len = sqrt(dot_product(v, v));
+		return vec2(v.x * target_length / len,
+			v.y * target_length / len);
+	}
+
+	static void align_rotation_to_vec(sf::Transformable& obj, sf::Vector2f vec) {
+		if (vec != sf::Vector2f())
+			obj.setRotation(std::atan2(vec.x, -vec.y) * 180.f / (float)PI);
+	}
+
+	static Real alpha(vec2 z, vec2 v, Real a) {
+		using std::sqrt;
+		Real zz = dot_product(z, z);
+		Real vv = dot_product(v, v);
+		Real zv = dot_product(z, v);
+		Real root = sqrt(zv * zv + zz * (a * a - vv));
+		return (zv + root) / zz;
+	}
+
+	bool close_to_prey(Real range) const {
+		return range < (predators_speed - prey_speed) * elapsed_last;
+	}
+
+	// Timer carrying the derivatives of the moment the remaining range would
+	// close, range / closing speed later, or -1 while the range isn't closing
+	Real capture_time(const Predator& predator, Real range) const {
+		vec2 relative_velocity = getPredatorVelocity(predator) - prey_velocity;
+		Real closing = range > 0 ? -dot_product(predator.position - prey_position,
+			relative_velocity) / range : Real(0);
+		if (closing <= 0) return -1;
+		return with_derivatives(simulation_timer, simulation_timer + range / closing);
+	}
+
+	// radii are sorted in decreasing order, so only the next one can be passed
+	void update_range_metrics(Predator& predator, Real range) {
+		predator.range = range;
+		if (predator.min_range < 0 || range < predator.min_range)
+			predator.min_range = range;
+		while (predator.radii_passed < metric_radii.size() &&
+			range <= metric_radii[predator.radii_passed])
+			predator.time_within[predator.radii_passed++] = simulation_timer;
+	}
+
+	//for file initialization begin
+
+	typedef bool(BasicSimulation::*Setter)(std::smatch&);
+	static const std::map<std::string, Setter>& simulation_setters();
+	static const std::map<std::string, Setter>& predator_setters();
+
+	static bool match_number_count(
+		const std::string& str, std::smatch& number_match, int count
+	);
+
+	bool set_prey_position(std::smatch& match);
+	bool set_predator_position(std::smatch& match);
+	bool set_prey_speed(std::smatch& match);
+	bool set_predators_speed(std::smatch& match);
+	bool set_prey_color(std::smatch& match);
+	bool set_predator_color(std::smatch& match);
+	bool set_lambda(std::smatch& match);
+	bool set_background_color(std::smatch& match);
+	bool set_text_color(std::smatch& match);
+	bool set_character_size(std::smatch& match);
+	bool set_point_radius(std::smatch& match);
+	bool set_trail(std::smatch& match);
+	bool set_zoom(std::smatch& match);
+	bool set_scale_speed(std::smatch& match);
+	bool set_rotation_acceleration(std::smatch& match);
+	bool add_straight_control(std::smatch& match);
+	bool add_rotating_control(std::smatch& match);
+	bool add_flee_control(std::smatch& match);
+	bool add_evasive_control(std::smatch& match);
+
+	void react(const Movement& movement, Real elapsed);
+
+	vec2 naiveDirection(const Predator& predator) {
+		return normalize(prey_position - predator.position, 1);
+	}
+
+	vec2 parallelDirection(const Predator& predator) {
+		Real a = predators_speed / prey_speed;
+		vec2 z = (predator.position - prey_position) / prey_speed; // X -- parallel, Y -- prey
+		vec2 v = normalize(prey_velocity, prey_speed);
+		vec2 u = v - z * alpha(z, v, a);
+		return normalize(u, 1);
+	}
+
+
+public:
+
+	float base_radius = 15.f;
+	float zoom = 0.02f;
+	float scale_speed = 0.003f;
+	float prey_rotation_acceleration = 1.f;
+	float time_scale = 1.f;
+	int substeps = 1;
+	Real prey_rotation_speed = 1.;
+	sf::Vector2f view_center{};
+
+	sf::View view;
+
+	Real prey_speed = 1.0; // 1.0
+	Real predators_speed = 1.2; // 1.5
+
+	sf::Color prey_color{ sf::Color::Blue };
+	sf::Color background_color{ 247, 247, 247 };
+	sf::Color text_color{ 16, 16, 16 };
+	int character_size = 20;
+
+	float trail_dash_time = 0.05f;
+	float trail_gap_time = 0.02f;
+	bool record_trails = true;
+	bool record_metrics = false;
+	std::vector<Real> metric_radii;
+
+	sf::VertexArray prey_trail{ sf::PrimitiveType::Lines };
+
+	Real simulation_timer = 0;
+
+	BasicSimulation() {}
+	BasicSimulation(std::istream& file, std::ostream& log = std::cout); // declaration because of std::map
+
+	void setPreyPosition(vec2 value) {
+		prey_position = value;
+		prey.setPosition(to_vec2f(prey_position));
+	}
+
+	void setPreyVelocity(vec2 value) {
+		move_by_plan = false;
+		prey_velocity = normalize(value, prey_speed);
+		align_rotation_to_vec(prey, to_vec2f(prey_velocity));
+	}
+
+	void rotatePreyVelocity(Real rotation) {
+		move_by_plan = false;
+		using std::atan2; using std::cos; using std::sin;
+		Real angle = prey_velocity == vec2() ? 0 : atan2(prey_velocity.y, prey_velocity.x);
+		angle += rotation;
+		prey_velocity = normalize(vec2(cos(angle), sin(angle)), prey_speed);
+		align_rotation_to_vec(prey, to_vec2f(prey_velocity));
+	}
+
+	vec2 getPreyPosition() const { return prey_position; }
+	vec2 getPreyVelocity() const { return normalize(prey_velocity, prey_speed); }
+	vec2 getPredatorPosition(const Predator& predator) const { return predator.position; }
+	vec2 getPredatorVelocity(const Predator& predator) const { return elapsed_last != 0 ? predator.velocity : vec2(); }
+
+	// continuous part of the state: prey position and velocity, then the
+	// position of every predator
+	std::vector<double> getState() const {
+		std::vector<double> state{ double(prey_position.x), double(prey_position.y),
+			double(prey_velocity.x), double(prey_velocity.y) };
+		for (const Predator& predator : predators) {
+			state.push_back(double(predator.position.x));
+			state.push_back(double(predator.position.y));
+		}
+		return state;
+	}
+
+	void setState(const std::vector<double>& state) {
+		prey_position = vec2(state[0], state[1]);
+		prey_velocity = vec2(state[2], state[3]);
+		prey.setPosition(to_vec2f(prey_position));
+		for (std::size_t i = 0; i < predators.size(); ++i) {
+			predators[i].position = vec2(state[4 + 2 * i], state[5 + 2 * i]);
+			predators[i].setPosition(to_vec2f(predators[i].position));
+		}
+	}
+
+	void setReached(std::size_t i, Real when) {
+		predators[i].when_reached = when;
+		active.erase(std::remove(active.begin(), active.end(), i), active.end());
+	}
+
+	// What the prey sees of the swarm, gathered in one pass over the active
+	// predators. The threat direction points from the prey towards the
+	// predators, each weighted by the inverse square of its range.
+	struct Threat {
+		std::size_t nearest = 0;
+		Real nearest_range = INFINITY;
+		vec2 direction;
+		Real time_to_go = INFINITY; // smallest range over closing speed
+	};
+
+	Threat observeThreat() const {
+		using std::sqrt;
+		Threat threat;
+		for (std::size_t i : active) {
+			const Predator& predator = predators[i];
+			vec2 line_of_sight = predator.position - prey_position;
+			Real range = sqrt(dot_product(line_of_sight, line_of_sight));
+			if (range == 0) continue;
+			if (range < threat.nearest_range) {
+				threat.nearest_range = range;
+				threat.nearest = i;
+			}
+			threat.direction += line_of_sight / (range * range * range);
+			Real closing = -dot_product(line_of_sight,
+				getPredatorVelocity(predator) - prey_velocity) / range;
+			if (closing > 0)
+				threat.time_to_go = std::min(threat.time_to_go, range / closing);
+		}
+		return threat;
+	}
+
+	// enables engagement metrics, call before simulating
+	void setMetricRadii(std::vector<Real> radii) {
+		std::sort(radii.begin(), radii.end(), std::greater<Real>());
+		metric_radii = radii;
+		record_metrics = true;
+		for (Predator& predator : predators) {
+			predator.time_within.assign(radii.size(), -1);
+			predator.radii_passed = 0;
+		}
+	}
+
+	// range at capture for reached predators, current range otherwise
+	Real missDistance(const Predator& predator) const {
+		return predator.when_reached >= 0 ? predator.range :
+			distance(prey_position, predator.position);
+	}
+
+	bool is_valid() const { return valid; }
+	bool all_reached() const { return active.empty(); }
+	std::size_t active_count() const { return active.size(); }
+
+	void applyZoom() {
+		float point_radius = zoom * base_radius;
+		prey.setOrigin(point_radius, point_radius);
+		prey.setRadius(point_radius);
+		for (Predator& predator : predators) {
+			predator.setOrigin(point_radius, point_radius);
+			predator.setRadius(point_radius);
+		}
+	}
+
+	void singleStepSimulate(Real elapsed); // substeps??
+
+	void simulate(Real elapsed);
+
+	// time_limit <= 0 runs until every predator reaches the prey
+	void simulateUntilReached(Real step, Real time_limit = 0);
+
+	virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const {
+		target.draw(prey_trail);
+		for (const Predator& predator : predators)
+			target.draw(predator.trail);
+
+		target.draw(prey);
+		for (const Predator& predator : predators)
+			target.draw(predator);
+	}
+};
+
+// Derivative slots of SimulationD. Every predator's lambda and start position
+// share the first three slots, so each capture time gets the derivatives with
+// respect to its own predator as long as the prey doesn't react to the swarm;
+// with reactive prey those slots sum over all predators.
+enum Sensitivity {
+	d_lambda, d_position_x, d_position_y, d_prey_speed, d_predators_speed, sensitivity_count
+};
+
+extern template class BasicSimulation<float>;
+extern template class BasicSimulation<double>;
+extern template class BasicSimulation<Dual<sensitivity_count>>;
+
+typedef BasicSimulation<double> Simulation;
+typedef BasicSimulation<float> SimulationF;
+typedef BasicSimulation<Dual<sensitivity_count>> SimulationD;
+
+// call after loading and before simulating
+inline void seed_sensitivities(SimulationD& S) {
+	for (SimulationD::Predator& predator : S.predators) {
+		predator.lambda.d[d_lambda] = 1;
+		predator.position.x.d[d_position_x] = 1;
+		predator.position.y.d[d_position_y] = 1;
+	}
+	S.prey_speed.d[d_prey_speed] = 1;
+	S.predators_speed.d[d_predators_speed] = 1;
+}